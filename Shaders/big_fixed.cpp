@@ -0,0 +1,194 @@
+#include <cctype>
+#include <cmath>
+
+#include "big_fixed.h"
+
+big_fixed::big_fixed(double d) {
+	if (!std::isfinite(d))
+		return;
+
+	double a = std::fmin(std::fabs(d), 2147483647.0);
+	double whole = std::floor(a);
+	double frac = a - whole;
+
+	_limbs[LIMBS - 1] = (uint32_t)whole;
+	for (int k = LIMBS - 2; k >= 0 && frac != 0.0; k--) {
+		frac = std::ldexp(frac, 32);
+		double limb = std::floor(frac);
+		_limbs[k] = (uint32_t)limb;
+		frac -= limb;
+	}
+
+	if (d < 0.0)
+		*this = -*this;
+}
+
+bool big_fixed::is_negative() const {
+	return (_limbs[LIMBS - 1] >> 31) != 0;
+}
+
+big_fixed big_fixed::magnitude() const {
+	return is_negative() ? -*this : *this;
+}
+
+uint32_t big_fixed::div_small(uint32_t d) {
+	uint64_t rem = 0;
+	for (int k = LIMBS - 1; k >= 0; k--) {
+		uint64_t cur = (rem << 32) | _limbs[k];
+		_limbs[k] = (uint32_t)(cur / d);
+		rem = cur % d;
+	}
+	return (uint32_t)rem;
+}
+
+bool big_fixed::parse(const char* text, big_fixed& out) {
+	const char* p = text;
+	while (std::isspace((unsigned char)*p))
+		p++;
+
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+
+	uint64_t whole = 0;
+	int digits = 0;
+	for (; std::isdigit((unsigned char)*p); p++, digits++) {
+		whole = whole * 10 + (uint64_t)(*p - '0');
+		if (whole > 0x7fffffff)
+			return false;
+	}
+
+	const char* fracBegin = p;
+	const char* fracEnd = p;
+	if (*p == '.') {
+		fracBegin = ++p;
+		while (std::isdigit((unsigned char)*p))
+			p++;
+		fracEnd = p;
+		digits += (int)(fracEnd - fracBegin);
+	}
+
+	while (std::isspace((unsigned char)*p))
+		p++;
+
+	if (digits == 0 || *p != '\0')
+		return false;
+
+	//Horner from the last digit: f = (f + digit) / 10
+	big_fixed value;
+	for (const char* c = fracEnd; c != fracBegin; c--) {
+		value._limbs[LIMBS - 1] = (uint32_t)(c[-1] - '0');
+		value.div_small(10);
+	}
+	value._limbs[LIMBS - 1] = (uint32_t)whole;
+
+	out = negative ? -value : value;
+	return true;
+}
+
+std::string big_fixed::toString(int digits) const {
+	big_fixed m = magnitude();
+
+	std::string s = is_negative() ? "-" : "";
+	s += std::to_string(m._limbs[LIMBS - 1]);
+	if (digits <= 0)
+		return s;
+
+	s += '.';
+	m._limbs[LIMBS - 1] = 0;
+	for (int i = 0; i < digits; i++) {
+		uint64_t carry = 0;
+		for (int k = 0; k < LIMBS; k++) {
+			uint64_t t = (uint64_t)m._limbs[k] * 10 + carry;
+			m._limbs[k] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		s += (char)('0' + m._limbs[LIMBS - 1]);
+		m._limbs[LIMBS - 1] = 0;
+	}
+	return s;
+}
+
+double big_fixed::toDouble() const {
+	big_fixed m = magnitude();
+
+	double d = 0.0;
+	for (int k = 0; k < LIMBS; k++)
+		d += std::ldexp((double)m._limbs[k], 32 * (k - FRACTION_LIMBS));
+
+	return is_negative() ? -d : d;
+}
+
+big_fixed big_fixed::operator-() const {
+	big_fixed r;
+	uint64_t carry = 1;
+	for (int k = 0; k < LIMBS; k++) {
+		uint64_t t = (uint64_t)(uint32_t)~_limbs[k] + carry;
+		r._limbs[k] = (uint32_t)t;
+		carry = t >> 32;
+	}
+	return r;
+}
+
+big_fixed& big_fixed::operator+=(const big_fixed& b) {
+	uint64_t carry = 0;
+	for (int k = 0; k < LIMBS; k++) {
+		uint64_t t = (uint64_t)_limbs[k] + b._limbs[k] + carry;
+		_limbs[k] = (uint32_t)t;
+		carry = t >> 32;
+	}
+	return *this;
+}
+
+big_fixed& big_fixed::operator-=(const big_fixed& b) {
+	return *this += -b;
+}
+
+big_fixed& big_fixed::operator*=(const big_fixed& b) {
+	return *this = *this * b;
+}
+
+big_fixed operator+(big_fixed a, const big_fixed& b) {
+	return a += b;
+}
+
+big_fixed operator-(big_fixed a, const big_fixed& b) {
+	return a -= b;
+}
+
+big_fixed operator*(const big_fixed& a, const big_fixed& b) {
+	big_fixed ma = a.magnitude();
+	big_fixed mb = b.magnitude();
+
+	//Schoolbook product, the low FRACTION_LIMBS limbs are truncated
+	uint32_t p[2 * big_fixed::LIMBS] = {};
+	for (int i = 0; i < big_fixed::LIMBS; i++) {
+		if (ma._limbs[i] == 0)
+			continue;
+
+		uint64_t carry = 0;
+		for (int j = 0; j < big_fixed::LIMBS; j++) {
+			uint64_t t = (uint64_t)ma._limbs[i] * mb._limbs[j] + p[i + j] + carry;
+			p[i + j] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		p[i + big_fixed::LIMBS] = (uint32_t)carry;
+	}
+
+	big_fixed r;
+	for (int k = 0; k < big_fixed::LIMBS; k++)
+		r._limbs[k] = p[k + big_fixed::FRACTION_LIMBS];
+
+	return a.is_negative() != b.is_negative() ? -r : r;
+}
+
+bool operator==(const big_fixed& a, const big_fixed& b) {
+	for (int k = 0; k < big_fixed::LIMBS; k++)
+		if (a._limbs[k] != b._limbs[k])
+			return false;
+	return true;
+}
+
+bool operator!=(const big_fixed& a, const big_fixed& b) {
+	return !(a == b);
+}
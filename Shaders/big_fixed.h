@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+* Signed fixed point number with a 32 bit integer part and 512 bits of fraction.
+* Used for the Mandelbrot view center and reference orbit, where a float or
+* double runs out of digits long before the zoom does (about 154 decimal
+* digits, enough for zooms past 1e140). Stored as two's complement 32 bit
+* limbs, least significant first.
+*/
+class big_fixed {
+
+public:
+
+	static constexpr int FRACTION_LIMBS = 16;
+	static constexpr int LIMBS = FRACTION_LIMBS + 1;
+
+private:
+
+	uint32_t _limbs[LIMBS] = {};
+
+	bool is_negative() const;
+
+	big_fixed magnitude() const;
+
+	//Divides a non-negative value by d, returns the remainder
+	uint32_t div_small(uint32_t d);
+
+public:
+
+	big_fixed() { }
+
+	//Exact for every double whose bits fit the fraction, the integer part must fit 31 bits
+	big_fixed(double d);
+
+	//Parses a plain decimal such as "-0.7436438870371587047521915", false if the text is not one
+	static bool parse(const char* text, big_fixed& out);
+
+	//Decimal with the given number of fraction digits (truncated)
+	std::string toString(int digits) const;
+
+	double toDouble() const;
+
+	big_fixed operator-() const;
+
+	big_fixed& operator+=(const big_fixed& b);
+	big_fixed& operator-=(const big_fixed& b);
+	big_fixed& operator*=(const big_fixed& b);
+
+	friend big_fixed operator+(big_fixed a, const big_fixed& b);
+	friend big_fixed operator-(big_fixed a, const big_fixed& b);
+	friend big_fixed operator*(const big_fixed& a, const big_fixed& b);
+
+	friend bool operator==(const big_fixed& a, const big_fixed& b);
+	friend bool operator!=(const big_fixed& a, const big_fixed& b);
+
+};
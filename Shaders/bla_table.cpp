@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstring>
+
+#include "bla_table.h"
+
+static glm::dvec2 cmul(glm::dvec2 a, glm::dvec2 b) {
+	return glm::dvec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+void bla_table::build(const reference_orbit& orbit, double dcMax) {
+	const glm::dvec2* z = orbit.getOrbit();
+
+	clear();
+	_dcMax = dcMax;
+
+	//Steps from m = 1 that end inside the orbit, m = 0 starts at Z = 0 and is never linear
+	_steps = std::max(orbit.getLength() - 2, 0);
+	if (_steps == 0)
+		return;
+
+	_entries.reserve((size_t)_steps * 2);
+
+	for (int j = 0; j < _steps; j++) {
+		glm::dvec2 zm = z[(size_t)j + 1];
+		_entries.push_back({ 2.0 * zm, glm::dvec2(1.0, 0.0), EPSILON * glm::length(zm), 0.0 });
+	}
+	_levels = 1;
+
+	//x followed by y: dz' = A_y (A_x dz + B_x dc) + B_y dc, and the intermediate offset must stay below R_y
+	while (_levels < MAX_LEVELS && (_steps >> _levels) > 0) {
+		int below = _levelStart[_levels - 1];
+		_levelStart[_levels] = (int)_entries.size();
+
+		int count = _steps >> _levels;
+		for (int j = 0; j < count; j++) {
+			entry x = _entries[(size_t)below + 2 * j];
+			entry y = _entries[(size_t)below + 2 * j + 1];
+
+			double ax = glm::length(x.a);
+			double ry = (y.radius - glm::length(x.b) * dcMax) / ax;
+			double r = ax > 0.0 ? std::max(0.0, std::min(x.radius, ry)) : x.radius;
+
+			_entries.push_back({ cmul(y.a, x.a), cmul(y.a, x.b) + y.b, r, 0.0 });
+		}
+		_levels++;
+	}
+}
+
+void bla_table::clear() {
+	_entries.clear();
+	_steps = 0;
+	_levels = 0;
+	std::memset(_levelStart, 0, sizeof(_levelStart));
+}
+
+const bla_table::entry* bla_table::find(int m, double dzMag2, int maxSteps, int& steps) const {
+	int j = m - 1;
+	if (j < 0 || _steps == 0)
+		return nullptr;
+
+	//Entries of level l start at multiples of 2^l
+	int top = _levels - 1;
+	while (top > 0 && (j & ((1 << top) - 1)) != 0)
+		top--;
+
+	for (int l = top; l >= 0; l--) {
+		int index = j >> l;
+		if (index >= (_steps >> l) || (1 << l) > maxSteps)
+			continue;
+
+		const entry& e = _entries[(size_t)_levelStart[l] + index];
+		if (dzMag2 < e.radius * e.radius) {
+			steps = 1 << l;
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+void bla_table::upload(ring_buffer& frame) const {
+	GLsizeiptr entriesSize = (GLsizeiptr)(_entries.size() * sizeof(entry));
+	ring_buffer::allocation alloc = frame.allocate_storage(sizeof(header) + entriesSize);
+
+	header h = {};
+	h.steps = _steps;
+	h.levels = _levels;
+	std::memcpy(h.levelStart, _levelStart, sizeof(_levelStart));
+	std::memcpy(alloc.ptr, &h, sizeof(header));
+	if (entriesSize > 0)
+		std::memcpy((unsigned char*)alloc.ptr + sizeof(header), _entries.data(), entriesSize);
+
+	ring_buffer::bind(GL_SHADER_STORAGE_BUFFER, BLA_TABLE_BINDING, alloc);
+}
+
+double bla_table::getDcMax() const {
+	return _dcMax;
+}
+
+int bla_table::getSize() const {
+	return (int)_entries.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "reference_orbit.h"
+#include "ring_buffer.h"
+
+//Shader storage binding point of the BilinearApprox block in data/bla_table.glsl
+constexpr unsigned int BLA_TABLE_BINDING = 2;
+
+/*
+* Bilinear approximations of a reference orbit, for skipping iterations.
+* While a pixel's offset dz is small next to Z, dz^2 is negligible and
+* 2^level steps from orbit index m collapse to dz' = A dz + B dc.
+* Level 0 holds single steps from m = 1, each higher level merges pairs of
+* the level below. An entry is valid while |dz| < radius; radii already
+* account for the largest |dc| of the view.
+*/
+class bla_table {
+
+public:
+
+	static constexpr int MAX_LEVELS = 32;
+
+	//Relative error allowed per entry, about float precision
+	static constexpr double EPSILON = 1.0 / (1 << 24);
+
+	//std430 BlaEntry
+	struct entry {
+		glm::dvec2 a;
+		glm::dvec2 b;
+		double radius;
+		double _pad;
+	};
+
+	static_assert(sizeof(entry) == 48, "entry must match the std430 BlaEntry struct");
+
+private:
+
+	//std430 header of the BilinearApprox block, the entries follow at offset 144
+	struct header {
+		GLint steps;
+		GLint levels;
+		GLint levelStart[MAX_LEVELS];
+		GLint _pad[2];
+	};
+
+	static_assert(sizeof(header) == 144, "header must match the std430 BilinearApprox block");
+
+	std::vector<entry> _entries;
+	int _steps = 0;
+	int _levels = 0;
+	int _levelStart[MAX_LEVELS] = {};
+	double _dcMax = 0.0;
+
+public:
+
+	//Build the table for pixels at most dcMax away from the reference
+	void build(const reference_orbit& orbit, double dcMax);
+
+	void clear();
+
+	//Largest valid entry starting at orbit index m that does not skip more than
+	//maxSteps iterations, nullptr if the pixel has to take a plain step
+	const entry* find(int m, double dzMag2, int maxSteps, int& steps) const;
+
+	//Write the table into the frame's ring and bind it to BLA_TABLE_BINDING
+	void upload(ring_buffer& frame) const;
+
+	double getDcMax() const;
+
+	int getSize() const;
+
+};
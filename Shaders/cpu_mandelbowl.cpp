@@ -0,0 +1,327 @@
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "cpu_mandelbowl.h"
+#include "iteration_budget.h"
+#include "mandelbrot_interior.h"
+
+static constexpr int TILE_SIZE = 32;
+
+static constexpr int PART_SKY = 0;
+static constexpr int PART_SET = 1;
+static constexpr int PART_INC = 2;
+
+static constexpr float FLOAT_PREC = 0.0000005f;
+static constexpr float SQRT_2 = 0.7071067812f;
+
+static const glm::vec3 ELLIPSOID(2.0f, 1.25f, 1.25f);
+
+static const glm::vec3 SKY(0.53f, 0.81f, 0.92f);
+static const glm::vec3 BLACK(0.0f);
+static const glm::vec3 BOWL(0.5f, 0.0f, 0.0f);
+static const glm::vec3 LIGHT_DIR(-SQRT_2, 0.0f, SQRT_2);
+
+//Per pixel output of the part and normal passes
+struct gbuffer_texel {
+	int part;
+	int mask;
+	glm::vec3 normal;
+};
+
+static bool equalf(float a, float b) {
+	float diff = std::abs(a - b);
+	return diff < FLOAT_PREC || diff < std::abs(a * FLOAT_PREC) || diff < std::abs(b * FLOAT_PREC);
+}
+
+static glm::vec2 eliIntersect(const glm::vec3& ro, const glm::vec3& rd, const glm::vec3& ra) {
+	glm::vec3 ocn = ro / ra;
+	glm::vec3 rdn = rd / ra;
+	float a = glm::dot(rdn, rdn);
+	float b = glm::dot(ocn, rdn);
+	float c = glm::dot(ocn, ocn);
+	float h = b * b - a * (c - 1.0f);
+	if (h < 0.0f)
+		return glm::vec2(-1.0f);
+	h = std::sqrt(h);
+	return glm::vec2(-b - h, -b + h) / a;
+}
+
+//The part pass scales the distance by log|Z|^2, the normal pass by log|Z|
+static float distanceToMandelbrot(glm::vec2 c, bool squaredLog, int maxIterations, long long& steps) {
+	if (inMainBulbs(c))
+		return 0.0f;
+
+	float di = 1.0f;
+	glm::vec2 z(0.0f);
+	float m2 = 0.0f;
+	glm::vec2 dz(0.0f);
+	period_check<glm::vec2> period;
+	for (int i = 0; i < maxIterations; i++) {
+		if (m2 > 1024.0f) {
+			di = 0.0f;
+			break;
+		}
+
+		dz = 2.0f * glm::vec2(z.x * dz.x - z.y * dz.y, z.x * dz.y + z.y * dz.x) + glm::vec2(1.0f, 0.0f);
+		z = glm::vec2(z.x * z.x - z.y * z.y, 2.0f * z.x * z.y) + c;
+		m2 = glm::dot(z, z);
+		steps++;
+
+		if (m2 <= 1024.0f && period.repeats(z, PERIOD_TOLERANCE))
+			return 0.0f;
+	}
+
+	float zz = glm::dot(z, z);
+	float d = 0.5f * std::sqrt(zz / glm::dot(dz, dz)) * std::log(squaredLog ? zz : std::sqrt(zz));
+	if (di > 0.5f)
+		d = 0.0f;
+	return d;
+}
+
+static float distanceToMandelbrot(glm::vec2 c, int maxIterations, long long& steps) {
+	return distanceToMandelbrot(c, false, maxIterations, steps);
+}
+
+static glm::vec2 cmul(glm::vec2 a, glm::vec2 b) {
+	return glm::vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+static glm::vec2 cdiv(glm::vec2 a, glm::vec2 b) {
+	return cmul(a, glm::vec2(b.x, -b.y)) / glm::dot(b, b);
+}
+
+//Distance estimate of the normal pass with its gradient in c, 0 inside the set
+static glm::vec3 distanceGradient(glm::vec2 c, int maxIterations, long long& steps) {
+	if (inMainBulbs(c))
+		return glm::vec3(0.0f);
+
+	glm::vec2 z(0.0f);
+	glm::vec2 dz(0.0f);
+	glm::vec2 ddz(0.0f);
+	float m2 = 0.0f;
+	period_check<glm::vec2> period;
+	for (int i = 0; i < maxIterations && m2 <= 1024.0f; i++) {
+		ddz = 2.0f * (cmul(dz, dz) + cmul(z, ddz));
+		dz = 2.0f * cmul(z, dz) + glm::vec2(1.0f, 0.0f);
+		z = cmul(z, z) + c;
+		m2 = glm::dot(z, z);
+		steps++;
+
+		if (m2 <= 1024.0f && period.repeats(z, PERIOD_TOLERANCE))
+			return glm::vec3(0.0f);
+	}
+
+	if (m2 <= 1024.0f)
+		return glm::vec3(0.0f);
+
+	float logZ = 0.5f * std::log(m2);
+	float d = 0.5f * std::sqrt(m2 / glm::dot(dz, dz)) * logZ;
+
+	glm::vec2 grad = cdiv(dz, z) * (1.0f + 1.0f / logZ);
+	glm::vec2 g2 = cdiv(ddz, dz);
+	if (std::isfinite(g2.x) && std::isfinite(g2.y))
+		grad -= g2;
+
+	return glm::vec3(d, d * grad.x, -d * grad.y);
+}
+
+static float raycast(const glm::vec3& ro, const glm::vec3& rd, const glm::vec3& rdx, const glm::vec3& rdy, int maxIterations, long long& steps) {
+	glm::vec2 intersections = eliIntersect(ro, rd, ELLIPSOID);
+	float t = ro.z >= 0.0f ? -ro.z / rd.z : intersections.x;
+
+	for (int i = 0; i < 128; i++) {
+		glm::vec3 pos = ro + t * rd;
+		float h = distanceToMandelbrot(glm::vec2(pos.x, glm::length(glm::vec2(pos.y, pos.z))), maxIterations, steps);
+		float dx = glm::length(pos - (ro + t * rdx));
+		float dy = glm::length(pos - (ro + t * rdy));
+
+		if (h <= 0.5f * glm::min(dx, dy))
+			break;
+
+		t += 0.75f * h;
+
+		if (t > intersections.y) {
+			t = -1.0f;
+			break;
+		}
+	}
+	return t;
+}
+
+//Camera basis of the passes; the part pass multiplies by the transposed view matrix
+struct camera_basis {
+	glm::vec3 cx, cy, cd;
+
+	explicit camera_basis(const frame_globals& g) {
+		cd = glm::normalize(g.cameraLookAt - g.cameraLoc);
+		cx = glm::normalize(g.cameraRight);
+		cy = glm::normalize(g.cameraUp);
+	}
+
+	glm::vec3 ray(glm::vec2 p, float fov) const {
+		return glm::normalize(cx * p.x + cy * p.y + cd * fov);
+	}
+
+	glm::vec3 transposedRay(glm::vec2 p, float fov) const {
+		glm::vec3 v(p, fov);
+		return glm::normalize(glm::vec3(glm::dot(cx, v), glm::dot(cy, v), glm::dot(cd, v)));
+	}
+};
+
+static glm::vec2 viewCoord(const frame_globals& g, glm::vec2 frag) {
+	return (2.0f * frag - g.resolution) / (g.resolution.y * g.zoom);
+}
+
+static int classify(const frame_globals& g, const camera_basis& basis, glm::vec2 frag, long long& steps) {
+	glm::vec3 ro = g.cameraLoc;
+	glm::vec3 rd = basis.transposedRay(viewCoord(g, frag), g.cameraFov);
+
+	glm::vec2 intersection = eliIntersect(ro, rd, ELLIPSOID);
+	float txy = !equalf(rd.z, 0.0f) ? -ro.z / rd.z : -1.0f;
+	glm::vec3 hit = ro + txy * rd;
+	float dist = distanceToMandelbrot(glm::vec2(hit), true, g.maxIterations, steps);
+
+	int part = PART_SKY;
+	bool set = equalf(dist, 0.0f);
+	bool inc = intersection.x >= 0.0f || intersection.y >= 0.0f;
+
+	if (inc)
+		inc = ((ro + intersection.x * rd).z <= FLOAT_PREC && intersection.x >= 0.0f) || ((ro + intersection.y * rd).z <= FLOAT_PREC && intersection.y >= 0.0f);
+
+	part = inc ? PART_INC : part;
+	if (txy >= 0.0f && set)
+		part = PART_SET;
+	return part;
+}
+
+static gbuffer_texel shadeGeometry(const frame_globals& g, const camera_basis& basis, glm::vec2 frag, long long& steps) {
+	gbuffer_texel out{ classify(g, basis, frag, steps), 0, glm::vec3(0.0f) };
+
+	glm::vec3 ro = g.cameraLoc;
+	glm::vec3 rd = basis.ray(viewCoord(g, frag), g.cameraFov);
+	glm::vec3 rdx = basis.ray(viewCoord(g, frag + glm::vec2(1.0f, 0.0f)), g.cameraFov);
+	glm::vec3 rdy = basis.ray(viewCoord(g, frag + glm::vec2(0.0f, 1.0f)), g.cameraFov);
+
+	if (out.part != PART_INC) {
+		out.normal = out.part == PART_SKY ? -rd : glm::vec3(0.0f, 0.0f, 1.0f);
+		return out;
+	}
+
+	float t = raycast(ro, rd, rdx, rdy, g.maxIterations, steps);
+	if (t < 0.0f) {
+		out.normal = -rd;
+		return out;
+	}
+	out.mask = 1;
+
+	glm::vec3 pos = ro + t * rd;
+	glm::vec2 yz(pos.y, pos.z);
+	float signY = pos.y > 0.0f ? 1.0f : (pos.y < 0.0f ? -1.0f : 0.0f);
+	glm::vec2 posXY(pos.x, signY * glm::length(yz));
+	glm::vec3 de = distanceGradient(posXY, g.maxIterations, steps);
+	float pixel = t * glm::length(rdx - rd);
+	for (int i = 0; i < 4 && de.x == 0.0f; i++) {
+		pos -= pixel * rd;
+		yz = glm::vec2(pos.y, pos.z);
+		signY = pos.y > 0.0f ? 1.0f : (pos.y < 0.0f ? -1.0f : 0.0f);
+		posXY = glm::vec2(pos.x, signY * glm::length(yz));
+		de = distanceGradient(posXY, g.maxIterations, steps);
+	}
+	glm::vec2 normal = de.x > 0.0f ? glm::normalize(glm::vec2(de.y, de.z)) : glm::vec2(-rd.x, -rd.y);
+
+	glm::vec2 dirYZ = glm::normalize(yz);
+	float cosA = signY * dirYZ.x;
+	float sinA = glm::length(glm::cross(glm::vec3(signY, 0.0f, 0.0f), glm::vec3(dirYZ, 0.0f)));
+	out.normal = glm::vec3(normal.x, normal.y * cosA, normal.y * sinA);
+	return out;
+}
+
+static glm::vec3 getLightColor(const frame_globals& g, const glm::vec3& norm, const glm::vec3& col) {
+	glm::vec3 ambient = 0.2f * col;
+	float diff = glm::max(glm::dot(-LIGHT_DIR, norm), 0.0f);
+	glm::vec3 diffuse = diff * col;
+	glm::vec3 viewDir = glm::normalize(g.cameraLookAt - g.cameraLoc);
+	glm::vec3 halfwayDir = glm::normalize(LIGHT_DIR + viewDir);
+	float spec = std::pow(glm::max(glm::dot(norm, halfwayDir), 0.0f), 32.0f);
+	return ambient + diffuse + glm::vec3(spec);
+}
+
+//Texel a GL_MIRRORED_REPEAT lookup one pixel outside the image lands on
+static int mirror(int i, int size) {
+	return i < 0 ? -1 - i : (i >= size ? 2 * size - 1 - i : i);
+}
+
+cpu_mandelbowl::cpu_mandelbowl(tile_scheduler& scheduler) : cpu_renderer(scheduler, TILE_SIZE) {
+
+}
+
+cpu_mandelbowl::~cpu_mandelbowl() {
+	cancel();
+}
+
+void cpu_mandelbowl::set_view(const frame_globals& globals, const shader_inputs& inputs) {
+	_view = globals;
+	_view.maxIterations = _maxIterations = iteration_budget::forZoom(inputs.zoom, BASE_ITERATIONS);
+}
+
+long long cpu_mandelbowl::render_tile(const tile_scheduler::tile& t) {
+	const frame_globals& g = _view;
+	const camera_basis basis(g);
+
+	//Geometry of the tile plus a one pixel apron
+	const int ax0 = t.x0 - 1, ay0 = t.y0 - 1;
+	const int aw = t.x1 - t.x0 + 2, ah = t.y1 - t.y0 + 2;
+	std::vector<gbuffer_texel> gbuffer((size_t)aw * ah);
+
+	long long steps = 0;
+
+	for (int y = 0; y < ah; y++) {
+		if (_scheduler.is_cancelled(t))
+			return steps;
+
+		for (int x = 0; x < aw; x++) {
+			glm::vec2 frag(mirror(ax0 + x, _width) + 0.5f, mirror(ay0 + y, _height) + 0.5f);
+			gbuffer[(size_t)y * aw + x] = shadeGeometry(g, basis, frag, steps);
+		}
+	}
+
+	auto texel = [&](int x, int y) -> const gbuffer_texel& {
+		return gbuffer[(size_t)(y - ay0) * aw + (x - ax0)];
+	};
+
+	for (int y = t.y0; y < t.y1; y++) {
+		unsigned char* row = _rgb.data() + ((size_t)y * _width + t.x0) * 3;
+
+		for (int x = t.x0; x < t.x1; x++) {
+			//Neighbour ring of the composite, starting bottom left and going counter clockwise
+			static const glm::ivec2 RING[8] = { {-1, -1}, {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0} };
+
+			glm::vec3 partCol[9];
+			for (int i = 0; i < 9; i++) {
+				const gbuffer_texel& n = i < 8 ? texel(x + RING[i].x, y + RING[i].y) : texel(x, y);
+				partCol[i] = BLACK;
+				if (n.part == PART_SKY)
+					partCol[i] = SKY;
+				if (n.part == PART_INC)
+					partCol[i] = n.mask == 1 ? BOWL : SKY;
+			}
+
+			//Half pixel offsets sample with nearest filtering, which picks the texel at or above the center
+			glm::vec3 col = partCol[8];
+			for (int i = 0; i < 8; i++) {
+				int nx = x + (RING[i].x > 0 ? 1 : 0);
+				int ny = y + (RING[i].y > 0 ? 1 : 0);
+				glm::vec3 lit = getLightColor(g, texel(nx, ny).normal, glm::mix(partCol[8], partCol[i], 0.5f));
+				col = (col * (float)(i + 1) + lit) / (float)(i + 2);
+			}
+
+			for (int c = 0; c < 3; c++)
+				row[(x - t.x0) * 3 + c] = (unsigned char)(glm::clamp(col[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	return steps;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "cpu_renderer.h"
+
+/*
+* CPU implementation of the mandelbowl passes.
+* Each tile classifies, marches and shades its pixels plus a one pixel apron,
+* which is all the composite reads from its neighbours, so tiles never wait on
+* each other. Follows data/mandelbowl_normals.glsl (classification and normals)
+* and data/mandelbowl.glsl step for step.
+*/
+class cpu_mandelbowl : public cpu_renderer {
+
+	frame_globals _view{};
+
+	long long render_tile(const tile_scheduler::tile& t) override;
+
+public:
+
+	//Must match mandelbowl::BASE_ITERATIONS
+	static constexpr int BASE_ITERATIONS = 300;
+
+	explicit cpu_mandelbowl(tile_scheduler& scheduler = tile_scheduler::shared());
+
+	~cpu_mandelbowl();
+
+	void set_view(const frame_globals& globals, const shader_inputs& inputs) override;
+
+};
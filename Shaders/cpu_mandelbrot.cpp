@@ -0,0 +1,357 @@
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define CPU_MANDELBROT_AVX512 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define CPU_MANDELBROT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_MANDELBROT_SSE2 1
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu_mandelbrot.h"
+#include "iteration_budget.h"
+#include "mandelbrot_interior.h"
+
+static constexpr int TILE_SIZE = 32;
+static constexpr int SAMPLES = 4;
+
+/*
+* Lane packs used by the iteration kernel, one per instruction set.
+* f is a vector of floats, m a per lane mask.
+*/
+#if defined(CPU_MANDELBROT_AVX512)
+struct lane_pack {
+	using f = __m512;
+	using m = __mmask16;
+	static constexpr int N = 16;
+	static constexpr const char* NAME = "AVX-512";
+
+	static f set1(float a) { return _mm512_set1_ps(a); }
+	static f load(const float* p) { return _mm512_loadu_ps(p); }
+	static void store(float* p, f a) { _mm512_storeu_ps(p, a); }
+	static f add(f a, f b) { return _mm512_add_ps(a, b); }
+	static f sub(f a, f b) { return _mm512_sub_ps(a, b); }
+	static f mul(f a, f b) { return _mm512_mul_ps(a, b); }
+	static m all() { return (m)0xFFFF; }
+	static m gt(f a, f b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+	static m andnot(m a, m b) { return (m)(~a & b); }
+	static m both(m a, m b) { return (m)(a & b); }
+	static m either(m a, m b) { return (m)(a | b); }
+	static bool any(m a) { return a != 0; }
+	static f select(m k, f a, f b) { return _mm512_mask_blend_ps(k, b, a); }
+	static f add_masked(f acc, f a, m k) { return _mm512_mask_add_ps(acc, k, acc, a); }
+};
+#elif defined(CPU_MANDELBROT_AVX2)
+struct lane_pack {
+	using f = __m256;
+	using m = __m256;
+	static constexpr int N = 8;
+	static constexpr const char* NAME = "AVX2";
+
+	static f set1(float a) { return _mm256_set1_ps(a); }
+	static f load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, f a) { _mm256_storeu_ps(p, a); }
+	static f add(f a, f b) { return _mm256_add_ps(a, b); }
+	static f sub(f a, f b) { return _mm256_sub_ps(a, b); }
+	static f mul(f a, f b) { return _mm256_mul_ps(a, b); }
+	static m all() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+	static m gt(f a, f b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static m andnot(m a, m b) { return _mm256_andnot_ps(a, b); }
+	static m both(m a, m b) { return _mm256_and_ps(a, b); }
+	static m either(m a, m b) { return _mm256_or_ps(a, b); }
+	static bool any(m a) { return _mm256_movemask_ps(a) != 0; }
+	static f select(m k, f a, f b) { return _mm256_blendv_ps(b, a, k); }
+	static f add_masked(f acc, f a, m k) { return _mm256_add_ps(acc, _mm256_and_ps(a, k)); }
+};
+#elif defined(CPU_MANDELBROT_SSE2)
+struct lane_pack {
+	using f = __m128;
+	using m = __m128;
+	static constexpr int N = 4;
+	static constexpr const char* NAME = "SSE2";
+
+	static f set1(float a) { return _mm_set1_ps(a); }
+	static f load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, f a) { _mm_storeu_ps(p, a); }
+	static f add(f a, f b) { return _mm_add_ps(a, b); }
+	static f sub(f a, f b) { return _mm_sub_ps(a, b); }
+	static f mul(f a, f b) { return _mm_mul_ps(a, b); }
+	static m all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+	static m gt(f a, f b) { return _mm_cmpgt_ps(a, b); }
+	static m andnot(m a, m b) { return _mm_andnot_ps(a, b); }
+	static m both(m a, m b) { return _mm_and_ps(a, b); }
+	static m either(m a, m b) { return _mm_or_ps(a, b); }
+	static bool any(m a) { return _mm_movemask_ps(a) != 0; }
+	static f select(m k, f a, f b) { return _mm_or_ps(_mm_and_ps(k, a), _mm_andnot_ps(k, b)); }
+	static f add_masked(f acc, f a, m k) { return _mm_add_ps(acc, _mm_and_ps(a, k)); }
+};
+#else
+struct lane_pack {
+	using f = float;
+	using m = bool;
+	static constexpr int N = 1;
+	static constexpr const char* NAME = "scalar";
+
+	static f set1(float a) { return a; }
+	static f load(const float* p) { return *p; }
+	static void store(float* p, f a) { *p = a; }
+	static f add(f a, f b) { return a + b; }
+	static f sub(f a, f b) { return a - b; }
+	static f mul(f a, f b) { return a * b; }
+	static m all() { return true; }
+	static m gt(f a, f b) { return a > b; }
+	static m andnot(m a, m b) { return !a && b; }
+	static m both(m a, m b) { return a && b; }
+	static m either(m a, m b) { return a || b; }
+	static bool any(m a) { return a; }
+	static f select(m k, f a, f b) { return k ? a : b; }
+	static f add_masked(f acc, f a, m k) { return k ? acc + a : acc; }
+};
+#endif
+
+//Escape time loop of mandelbrot() for lane_pack::N samples at once. Lanes stop
+//updating once they escape or are found interior, the loop ends when every lane
+//is done or hit the cap. Returns the number of z updates performed by the first valid lanes.
+static long long iterate(const float* cx, const float* cy, float* count, float* mag2, int valid, int maxIterations) {
+	using P = lane_pack;
+
+	const P::f cr = P::load(cx);
+	const P::f ci = P::load(cy);
+	const P::f one = P::set1(1.0f);
+	const P::f two = P::set1(2.0f);
+	const P::f bailout = P::set1(cpu_mandelbrot::BAILOUT);
+
+	const P::f zero = P::set1(0.0f);
+	const P::f tolerance = P::set1(PERIOD_TOLERANCE);
+
+	//inMainBulbs() for every lane
+	P::f c2 = P::add(P::mul(cr, cr), P::mul(ci, ci));
+	P::f m1Test = P::sub(P::add(P::sub(P::mul(P::mul(P::set1(256.0f), c2), c2), P::mul(P::set1(96.0f), c2)), P::mul(P::set1(32.0f), cr)), P::set1(3.0f));
+	P::f m2Test = P::sub(P::mul(P::set1(16.0f), P::add(P::add(c2, P::mul(two, cr)), one)), one);
+	P::m interior = P::either(P::gt(zero, m1Test), P::gt(zero, m2Test));
+
+	P::f zr = P::set1(0.0f);
+	P::f zi = P::set1(0.0f);
+	P::f m2 = P::set1(0.0f);
+	P::f it = P::set1(0.0f);
+	P::m active = P::andnot(interior, P::all());
+
+	//Brent periodicity check, every lane saves its orbit point at the same iterations
+	P::f savedR = zr;
+	P::f savedI = zi;
+	int counter = 0;
+	int interval = 1;
+
+	for (int i = 0; i < maxIterations && P::any(active); i++) {
+		P::f nzr = P::add(P::sub(P::mul(zr, zr), P::mul(zi, zi)), cr);
+		P::f nzi = P::add(P::mul(P::mul(zr, zi), two), ci);
+		zr = P::select(active, nzr, zr);
+		zi = P::select(active, nzi, zi);
+		m2 = P::select(active, P::add(P::mul(zr, zr), P::mul(zi, zi)), m2);
+
+		active = P::andnot(P::gt(m2, bailout), active);
+		it = P::add_masked(it, one, active);
+
+		P::f dr = P::sub(zr, savedR);
+		P::f di = P::sub(zi, savedI);
+		P::m repeats = P::both(P::gt(tolerance, P::add(P::mul(dr, dr), P::mul(di, di))), active);
+		interior = P::either(interior, repeats);
+		active = P::andnot(repeats, active);
+
+		if (++counter == interval) {
+			savedR = zr;
+			savedI = zi;
+			counter = 0;
+			interval *= 2;
+		}
+	}
+
+	//Escaped lanes also paid for the update that took them out
+	P::store(count, P::add_masked(it, one, P::andnot(interior, P::gt(m2, bailout))));
+
+	long long steps = 0;
+	for (int l = 0; l < valid; l++)
+		steps += (long long)count[l];
+
+	//Interior lanes report the cap so they are drawn black
+	P::store(count, P::select(interior, P::set1((float)maxIterations), it));
+	P::store(mag2, m2);
+	return steps;
+}
+
+//Smooth iteration count, 0 for samples that never escaped
+static float smoothCount(float count, float mag2, int maxIterations) {
+	if (count > maxIterations - 1)
+		return 0.0f;
+	return count - std::log2(std::log2(mag2));
+}
+
+static glm::dvec2 cmul(glm::dvec2 a, glm::dvec2 b) {
+	return glm::dvec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+//mandelbrotPerturbed() from data/mandelbrot.glsl, returns the iteration the sample escaped on
+static int iteratePerturbed(const reference_orbit& ref, const bla_table& bla, glm::dvec2 dc, int maxIterations, double& mag2) {
+	const glm::dvec2* orbit = ref.getOrbit();
+	const int length = ref.getLength();
+
+	glm::dvec2 dz(0.0);
+	int m = 0;
+	int i = 0;
+	period_check<glm::dvec2> period;
+	mag2 = 0.0;
+	while (i < maxIterations) {
+		int steps = 1;
+		const bla_table::entry* e = bla.find(m, glm::dot(dz, dz), maxIterations - i, steps);
+		if (e)
+			dz = cmul(e->a, dz) + cmul(e->b, dc);
+		else
+			dz = cmul(2.0 * orbit[m] + dz, dz) + dc;
+		m += steps;
+
+		glm::dvec2 z = orbit[m] + dz;
+		mag2 = glm::dot(z, z);
+		if (mag2 > reference_orbit::BAILOUT)
+			return i + steps - 1;
+		i += steps;
+
+		if (period.repeats(z, PERIOD_TOLERANCE_DEEP, steps))
+			return maxIterations;
+
+		if (mag2 < glm::dot(dz, dz) || m == length - 1) {
+			dz = z;
+			m = 0;
+		}
+	}
+	return i;
+}
+
+//getColor() from data/mandelbrot.glsl
+static glm::vec3 getColor(float it) {
+	if (it == 0.0f)
+		return glm::vec3(0.0f);
+	return 0.5f + 0.5f * glm::cos(3.0f + it * 0.15f + glm::vec3(0.0f, 0.6f, 1.0f));
+}
+
+cpu_mandelbrot::cpu_mandelbrot(tile_scheduler& scheduler) : cpu_renderer(scheduler, TILE_SIZE) {
+
+}
+
+cpu_mandelbrot::~cpu_mandelbrot() {
+	cancel();
+}
+
+void cpu_mandelbrot::set_view(const frame_globals& globals, const shader_inputs& inputs) {
+	//Tiles still running read the orbit and table
+	cancel();
+
+	_center = glm::vec2(globals.cameraLoc);
+	_zoom = globals.zoom;
+	_resolution = globals.resolution;
+	_maxIterations = iteration_budget::forZoom(inputs.zoom, BASE_ITERATIONS);
+
+	_deep = inputs.zoom >= DEEP_ZOOM;
+	if (!_deep)
+		return;
+
+	_pixelScale = 1.0 / (globals.resolution.y * inputs.zoom);
+
+	double dcMax = _pixelScale * glm::length(glm::dvec2(globals.resolution) + 1.0);
+	if (_orbit.compute(inputs.centerX, inputs.centerY, _maxIterations) || dcMax != _bla.getDcMax())
+		_bla.build(_orbit, dcMax);
+}
+
+long long cpu_mandelbrot::render_tile_deep(const tile_scheduler::tile& t) {
+	const glm::dvec2 res(_resolution);
+	const double halfX = 0.5 * _pixelScale * res.y / res.x;
+	const double halfY = 0.5 * _pixelScale;
+	const glm::dvec2 offsets[SAMPLES] = { {0.0, 0.0}, {0.0, halfY}, {halfX, 0.0}, {halfX, halfY} };
+
+	long long steps = 0;
+
+	for (int y = t.y0; y < t.y1 && !_scheduler.is_cancelled(t); y++) {
+		unsigned char* row = _rgb.data() + ((size_t)y * _width + t.x0) * 3;
+		for (int x = t.x0; x < t.x1; x++) {
+			glm::dvec2 dc = (2.0 * glm::dvec2(x + 0.5, y + 0.5) - res) * _pixelScale;
+
+			glm::vec3 col(0.0f);
+			for (int s = 0; s < SAMPLES; s++) {
+				double mag2;
+				int count = iteratePerturbed(_orbit, _bla, dc + offsets[s], _maxIterations, mag2);
+				steps += count + (count < _maxIterations ? 1 : 0);
+				col += getColor(smoothCount((float)count, (float)mag2, _maxIterations));
+			}
+			col /= (float)SAMPLES;
+
+			for (int c = 0; c < 3; c++)
+				row[(x - t.x0) * 3 + c] = (unsigned char)(glm::clamp(col[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	return steps;
+}
+
+long long cpu_mandelbrot::render_tile(const tile_scheduler::tile& t) {
+	if (_deep)
+		return render_tile_deep(t);
+
+	constexpr int N = lane_pack::N;
+	const int width = t.x1 - t.x0;
+	const int count = width * SAMPLES;
+	const int padded = (count + N - 1) / N * N;
+
+	std::vector<float> cx(padded), cy(padded), it(padded), mag2(padded);
+
+	const glm::vec2 res = _resolution;
+	const float halfX = 0.5f / (res.x * _zoom);
+	const float halfY = 0.5f / (res.y * _zoom);
+	const glm::vec2 offsets[SAMPLES] = { {0.0f, 0.0f}, {0.0f, halfY}, {halfX, 0.0f}, {halfX, halfY} };
+
+	long long steps = 0;
+
+	for (int y = t.y0; y < t.y1 && !_scheduler.is_cancelled(t); y++) {
+		//Same float math as main() in the shader, gl_FragCoord is at the pixel center
+		for (int x = t.x0; x < t.x1; x++) {
+			glm::vec2 frag((float)x + 0.5f, (float)y + 0.5f);
+			glm::vec2 loc = (2.0f * frag - res) / (res.y * _zoom) + _center;
+			for (int s = 0; s < SAMPLES; s++) {
+				int i = (x - t.x0) * SAMPLES + s;
+				cx[i] = loc.x + offsets[s].x;
+				cy[i] = loc.y + offsets[s].y;
+			}
+		}
+		//Padding lanes escape on the first iteration so they never keep a pack running
+		for (int i = count; i < padded; i++) {
+			cx[i] = 1024.0f;
+			cy[i] = 0.0f;
+		}
+
+		for (int i = 0; i < padded; i += N)
+			steps += iterate(&cx[i], &cy[i], &it[i], &mag2[i], std::min(N, count - i), _maxIterations);
+
+		unsigned char* row = _rgb.data() + ((size_t)y * _width + t.x0) * 3;
+		for (int x = 0; x < width; x++) {
+			glm::vec3 col(0.0f);
+			for (int s = 0; s < SAMPLES; s++)
+				col += getColor(smoothCount(it[x * SAMPLES + s], mag2[x * SAMPLES + s], _maxIterations));
+			col /= (float)SAMPLES;
+
+			for (int c = 0; c < 3; c++)
+				row[x * 3 + c] = (unsigned char)(glm::clamp(col[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	return steps;
+}
+
+const char* cpu_mandelbrot::isa() {
+	return lane_pack::NAME;
+}
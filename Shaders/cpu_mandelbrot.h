@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bla_table.h"
+#include "cpu_renderer.h"
+#include "reference_orbit.h"
+
+/*
+* CPU implementation of data/mandelbrot.glsl.
+* Iterates several samples at once with the widest SIMD the build targets
+* (AVX-512, AVX2, SSE2 or scalar), one tile per scheduler task.
+* Follows the shader's kernels, including its perturbation path with BLA
+* iteration skipping for deep zooms, but takes a fixed 4 samples per pixel
+* where the shader only supersamples pixels with detail.
+*/
+class cpu_mandelbrot : public cpu_renderer {
+
+	glm::vec2 _center = glm::vec2(0.0f);
+	float _zoom = 1.0f;
+	glm::vec2 _resolution = glm::vec2(0.0f);
+
+	bool _deep = false;
+	double _pixelScale = 0.0;
+	reference_orbit _orbit;
+	bla_table _bla;
+
+	long long render_tile(const tile_scheduler::tile& t) override;
+
+	long long render_tile_deep(const tile_scheduler::tile& t);
+
+public:
+
+	//Must match mandelbrot::BASE_ITERATIONS and the bailout of data/mandelbrot.glsl.
+	//The cap follows the zoom rule only, there is no histogram to tune it from.
+	static constexpr int BASE_ITERATIONS = 512;
+	static constexpr float BAILOUT = 256.0f * 256.0f;
+
+	//Must match mandelbrot::DEEP_ZOOM
+	static constexpr double DEEP_ZOOM = 1e4;
+
+	explicit cpu_mandelbrot(tile_scheduler& scheduler = tile_scheduler::shared());
+
+	~cpu_mandelbrot();
+
+	void set_view(const frame_globals& globals, const shader_inputs& inputs) override;
+
+	//Name of the instruction set the iteration kernel was compiled for
+	static const char* isa();
+
+};
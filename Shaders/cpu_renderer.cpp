@@ -0,0 +1,88 @@
+
+#include "cpu_renderer.h"
+
+cpu_renderer::cpu_renderer(tile_scheduler& scheduler, int tileSize) : _scheduler(scheduler), _tileSize(tileSize), _pending(0), _iterations(0) {
+
+}
+
+void cpu_renderer::start(int width, int height, glm::vec2 focus) {
+	cancel();
+
+	_width = width;
+	_height = height;
+	_rgb.assign((size_t)glm::max(width, 0) * glm::max(height, 0) * 3, 0);
+	_finished.clear();
+
+	const int tilesX = (width + _tileSize - 1) / _tileSize;
+	const int tilesY = (height + _tileSize - 1) / _tileSize;
+	_pending = width > 0 && height > 0 ? tilesX * tilesY : 0;
+	_iterations = 0;
+	_start = _end = std::chrono::steady_clock::now();
+
+	_generation = _scheduler.submit(width, height, _tileSize, focus, [this](const tile_scheduler::tile& t) {
+		_iterations += render_tile(t);
+		if (_scheduler.is_cancelled(t))
+			return;
+
+		{
+			std::lock_guard<std::mutex> guard(_finishedLock);
+			_finished.push_back(t);
+			if (--_pending == 0)
+				_end = std::chrono::steady_clock::now();
+		}
+	});
+}
+
+void cpu_renderer::cancel() {
+	if (_pending > 0 && !_scheduler.is_cancelled(_generation))
+		_scheduler.cancel();
+}
+
+cpu_renderer::stats cpu_renderer::wait() {
+	if (!_scheduler.is_cancelled(_generation))
+		_scheduler.wait();
+
+	stats result;
+	result.seconds = std::chrono::duration<double>(_end - _start).count();
+	result.iterations = _iterations;
+	if (result.seconds > 0.0) {
+		result.mpixelsPerSecond = (double)_width * _height / result.seconds / 1e6;
+		result.gitersPerSecond = (double)result.iterations / result.seconds / 1e9;
+	}
+	return result;
+}
+
+bool cpu_renderer::is_done() const {
+	return _pending == 0;
+}
+
+bool cpu_renderer::was_cancelled() const {
+	return _pending > 0 && _scheduler.is_cancelled(_generation);
+}
+
+void cpu_renderer::take_finished(std::vector<tile_scheduler::tile>& out) {
+	std::lock_guard<std::mutex> guard(_finishedLock);
+	out.insert(out.end(), _finished.begin(), _finished.end());
+	_finished.clear();
+}
+
+bool cpu_renderer::has_finished() const {
+	std::lock_guard<std::mutex> guard(_finishedLock);
+	return !_finished.empty();
+}
+
+const std::vector<unsigned char>& cpu_renderer::getImage() const {
+	return _rgb;
+}
+
+int cpu_renderer::getWidth() const {
+	return _width;
+}
+
+int cpu_renderer::getHeight() const {
+	return _height;
+}
+
+int cpu_renderer::getMaxIterations() const {
+	return _maxIterations;
+}
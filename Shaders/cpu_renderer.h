@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "frame_globals.h"
+#include "shader_inputs.h"
+#include "tile_scheduler.h"
+
+/*
+* Base of the CPU scene renderers.
+* Renders tightly packed RGB rows, bottom row first like glReadPixels, one
+* tile at a time on a tile_scheduler. Rendering runs in the background:
+* finished tiles can be picked up while the rest of the image is in flight,
+* and starting a new view cancels the old one.
+*/
+class cpu_renderer {
+
+public:
+
+	struct stats {
+		double seconds = 0.0;
+		long long iterations = 0;
+		double mpixelsPerSecond = 0.0;
+		double gitersPerSecond = 0.0;
+	};
+
+protected:
+
+	tile_scheduler& _scheduler;
+	const int _tileSize;
+
+	int _width = 0;
+	int _height = 0;
+	int _maxIterations = 0;
+	std::vector<unsigned char> _rgb;
+
+	unsigned _generation = 0;
+	std::atomic<int> _pending;
+	std::atomic<long long> _iterations;
+	std::chrono::steady_clock::time_point _start;
+	std::chrono::steady_clock::time_point _end;
+
+	mutable std::mutex _finishedLock;
+	std::vector<tile_scheduler::tile> _finished;
+
+	//Render one tile into _rgb and return the iterations spent.
+	//Long tiles should return early once _scheduler.is_cancelled(t).
+	virtual long long render_tile(const tile_scheduler::tile& t) = 0;
+
+public:
+
+	cpu_renderer(tile_scheduler& scheduler, int tileSize);
+
+	cpu_renderer(const cpu_renderer&) = delete;
+	cpu_renderer& operator=(const cpu_renderer&) = delete;
+
+	//Derived classes must cancel() in their destructor, tiles call back into them
+	virtual ~cpu_renderer() = default;
+
+	//Take the camera, zoom and resolution of the next start() from the frame globals,
+	//inputs carry what does not fit them (the full precision 2D center and zoom)
+	virtual void set_view(const frame_globals& globals, const shader_inputs& inputs) = 0;
+
+	//Start rendering width x height in the background, tiles closest to focus first
+	void start(int width, int height, glm::vec2 focus);
+
+	void cancel();
+
+	//Block until the image is done
+	stats wait();
+
+	bool is_done() const;
+
+	//True when the image was abandoned half way because another job took the scheduler
+	bool was_cancelled() const;
+
+	//Move the tiles finished since the last call into out
+	void take_finished(std::vector<tile_scheduler::tile>& out);
+
+	bool has_finished() const;
+
+	const std::vector<unsigned char>& getImage() const;
+	int getWidth() const;
+	int getHeight() const;
+
+	//Iteration cap set_view chose for the view, 0 for renderers without one
+	int getMaxIterations() const;
+
+};
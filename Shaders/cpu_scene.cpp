@@ -0,0 +1,94 @@
+
+#include <glad/glad.h>
+
+#include "cpu_scene.h"
+
+cpu_scene::cpu_scene(std::unique_ptr<cpu_renderer> renderer, shader_inputs&& inputs) : shader_object("data/cpu_image.glsl"),
+	_inputs(std::move(inputs)), _renderer(std::move(renderer)) {
+
+}
+
+cpu_scene::~cpu_scene() {
+	_renderer->cancel();
+	glDeleteTextures(1, &_texture);
+}
+
+shader_inputs* cpu_scene::get_inputs() {
+	return &_inputs;
+}
+
+bool cpu_scene::has_input_shaders() const {
+	return false;
+}
+
+int cpu_scene::input_shaders_count() const {
+	return 0;
+}
+
+GLuint cpu_scene::setup_input_shader(const int index) {
+	return 0;
+}
+
+bool cpu_scene::is_updating() const {
+	return !_renderer->is_done() || _renderer->has_finished();
+}
+
+bool cpu_scene::view_changed(const frame_globals& globals) const {
+	return !_hasStarted || globals.cameraLoc != _started.cameraLoc || globals.cameraLookAt != _started.cameraLookAt ||
+		globals.cameraUp != _started.cameraUp || globals.cameraRight != _started.cameraRight ||
+		globals.cameraFov != _started.cameraFov || globals.resolution != _started.resolution ||
+		globals.zoom != _started.zoom || _inputs.zoom != _startedInputs.zoom ||
+		_inputs.centerX != _startedInputs.centerX || _inputs.centerY != _startedInputs.centerY;
+}
+
+void cpu_scene::ensure_texture(glm::ivec2 size) {
+	if (size == _textureSize && _texture)
+		return;
+
+	glDeleteTextures(1, &_texture);
+
+	glGenTextures(1, &_texture);
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size.x, size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	const unsigned char black[3] = { 0, 0, 0 };
+	glClearTexImage(_texture, 0, GL_RGB, GL_UNSIGNED_BYTE, black);
+
+	_textureSize = size;
+}
+
+void cpu_scene::prepare_frame(const frame_globals& globals) {
+	glm::ivec2 size(globals.resolution);
+	ensure_texture(size);
+
+	//Another scene took the scheduler while this one was hidden, start over as well
+	if (view_changed(globals) || _renderer->was_cancelled()) {
+		bool hover = globals.cursorPos.x >= 0.0f && globals.cursorPos.y >= 0.0f &&
+			globals.cursorPos.x < globals.resolution.x && globals.cursorPos.y < globals.resolution.y;
+
+		_renderer->set_view(globals, _inputs);
+		_inputs.maxIterations = _renderer->getMaxIterations();
+		_renderer->start(size.x, size.y, hover ? globals.cursorPos : 0.5f * globals.resolution);
+
+		_started = globals;
+		_startedInputs = _inputs;
+		_hasStarted = true;
+	}
+
+	_tiles.clear();
+	_renderer->take_finished(_tiles);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _texture);
+
+	//Tiles of the old view stay on screen until the new ones replace them
+	const unsigned char* rgb = _renderer->getImage().data();
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+	for (const tile_scheduler::tile& t : _tiles)
+		glTexSubImage2D(GL_TEXTURE_2D, 0, t.x0, t.y0, t.x1 - t.x0, t.y1 - t.y0, GL_RGB, GL_UNSIGNED_BYTE, rgb + ((size_t)t.y0 * size.x + t.x0) * 3);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <memory>
+#include <vector>
+
+#include "cpu_renderer.h"
+#include "shader_object.h"
+
+/*
+* Shows a cpu_renderer in the window.
+* The image is rendered in the background and finished tiles are uploaded
+* every frame, so it fills in around the cursor first. Moving the camera
+* cancels the tiles still in flight and starts over.
+*/
+class cpu_scene : public shader_object {
+
+	shader_inputs _inputs;
+
+	std::unique_ptr<cpu_renderer> _renderer;
+
+	GLuint _texture = 0;
+	glm::ivec2 _textureSize = glm::ivec2(0);
+
+	frame_globals _started{};
+	shader_inputs _startedInputs;
+	bool _hasStarted = false;
+
+	std::vector<tile_scheduler::tile> _tiles;
+
+	bool view_changed(const frame_globals& globals) const;
+
+	void ensure_texture(glm::ivec2 size);
+
+public:
+
+	cpu_scene(std::unique_ptr<cpu_renderer> renderer, shader_inputs&& inputs);
+
+	~cpu_scene() override;
+
+	shader_inputs* get_inputs() override;
+
+	bool has_input_shaders() const override;
+
+	int input_shaders_count() const override;
+
+	GLuint setup_input_shader(const int index) override;
+
+	void framebuffer_resize(int width, int height) override { }
+
+	bool is_updating() const override;
+
+	void prepare_frame(const frame_globals& globals) override;
+
+};
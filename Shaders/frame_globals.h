@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+//Uniform buffer binding point of the FrameGlobals block in data/frame_globals.glsl
+constexpr unsigned int FRAME_GLOBALS_BINDING = 0;
+
+/*
+* CPU mirror of the std140 FrameGlobals uniform block.
+* Every vec3 is followed by a float to match std140 alignment.
+*/
+struct frame_globals {
+	glm::vec3 cameraLoc;
+	float _pad0;
+	glm::vec3 cameraLookAt;
+	float _pad1;
+	glm::vec3 cameraUp;
+	float _pad2;
+	glm::vec3 cameraRight;
+	float cameraFov;
+
+	glm::vec2 resolution;
+	glm::vec2 cursorPos;
+	float time;
+	float elapsedTime;
+	float zoom;
+	float zoomRaw;
+
+	int maxIterations;
+	int samples;
+	float _pad3[2];
+};
+
+static_assert(sizeof(frame_globals) == 112, "frame_globals must match the std140 FrameGlobals block");
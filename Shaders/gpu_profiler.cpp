@@ -0,0 +1,133 @@
+#include <glad/glad.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+
+#include "gpu_profiler.h"
+
+void gpu_profiler::history::add(float value) {
+	ms[next] = value;
+	next = (next + 1) % HISTORY;
+	count = std::min(count + 1, HISTORY);
+}
+
+gpu_profiler::stats gpu_profiler::history::compute() const {
+	stats s;
+	if (count == 0)
+		return s;
+
+	float sorted[HISTORY];
+	std::copy(ms, ms + count, sorted);
+	std::sort(sorted, sorted + count);
+
+	float sum = 0.0f;
+	for (int i = 0; i < count; i++)
+		sum += sorted[i];
+
+	s.min = sorted[0];
+	s.avg = sum / count;
+	s.p95 = sorted[(count - 1) * 95 / 100];
+	s.p99 = sorted[(count - 1) * 99 / 100];
+	return s;
+}
+
+gpu_profiler::~gpu_profiler() {
+	for (section& s : _sections)
+		glDeleteQueries(BUFFERS * 2, &s.queries[0][0]);
+}
+
+void gpu_profiler::setEnabled(bool enabled) {
+	_enabled = enabled;
+}
+
+bool gpu_profiler::isEnabled() const {
+	return _enabled;
+}
+
+int gpu_profiler::find(const char* name) {
+	for (int i = 0; i < (int)_sections.size(); i++)
+		if (_sections[i].name == name)
+			return i;
+
+	_sections.emplace_back();
+	section& s = _sections.back();
+	s.name = name;
+	glGenQueries(BUFFERS * 2, &s.queries[0][0]);
+	return (int)_sections.size() - 1;
+}
+
+void gpu_profiler::read_back(section& s, int buffer) {
+	if (!s.pending[buffer])
+		return;
+	s.pending[buffer] = false;
+
+	//Checking the end timestamp is enough, queries complete in order
+	GLint available = 0;
+	glGetQueryObjectiv(s.queries[buffer][1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint64 start = 0;
+	GLuint64 stop = 0;
+	glGetQueryObjectui64v(s.queries[buffer][0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(s.queries[buffer][1], GL_QUERY_RESULT, &stop);
+
+	s.gpu.add((float)((stop - start) * 1e-6));
+	s.cpu.add(s.cpuMs[buffer]);
+}
+
+void gpu_profiler::begin_frame() {
+	_frame++;
+	_open.clear();
+
+	int buffer = _frame % BUFFERS;
+	for (section& s : _sections)
+		read_back(s, buffer);
+}
+
+void gpu_profiler::begin(const char* name) {
+	if (!_enabled)
+		return;
+
+	int index = find(name);
+	section& s = _sections[index];
+	int buffer = _frame % BUFFERS;
+
+	glQueryCounter(s.queries[buffer][0], GL_TIMESTAMP);
+	s.cpuStart = clock::now();
+	_open.push_back(index);
+}
+
+void gpu_profiler::end() {
+	if (_open.empty())
+		return;
+
+	section& s = _sections[_open.back()];
+	_open.pop_back();
+	int buffer = _frame % BUFFERS;
+
+	glQueryCounter(s.queries[buffer][1], GL_TIMESTAMP);
+	s.cpuMs[buffer] = std::chrono::duration<float, std::milli>(clock::now() - s.cpuStart).count();
+	s.pending[buffer] = true;
+}
+
+void gpu_profiler::draw_imgui() {
+	if (!_enabled)
+		return;
+
+	ImGui::Begin("Profiler");
+
+	for (const section& s : _sections) {
+		stats gpu = s.gpu.compute();
+		stats cpu = s.cpu.compute();
+
+		//Oldest sample first once the history has wrapped
+		int offset = s.gpu.count == HISTORY ? s.gpu.next : 0;
+		ImGui::PlotLines(s.name.c_str(), s.gpu.ms, s.gpu.count, offset, NULL, 0.0f, std::max(gpu.p99 * 1.25f, 0.1f), ImVec2(0.0f, 40.0f));
+		ImGui::Text("GPU min %.2f avg %.2f p95 %.2f p99 %.2f ms", gpu.min, gpu.avg, gpu.p95, gpu.p99);
+		ImGui::Text("CPU min %.2f avg %.2f p95 %.2f p99 %.2f ms", cpu.min, cpu.avg, cpu.p95, cpu.p99);
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+* Per-pass GPU and CPU timings.
+* Each section is bracketed by glQueryCounter timestamps, double buffered so
+* a frame's results are read back when its buffer comes around again,
+* without waiting on the GPU (a result still not available is dropped).
+* The last HISTORY samples of every section are kept for the ImGui overlay.
+*/
+class gpu_profiler {
+
+public:
+
+	static constexpr int BUFFERS = 2;
+	static constexpr int HISTORY = 240;
+
+	struct stats {
+		float min = 0.0f;
+		float avg = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+	};
+
+private:
+
+	using clock = std::chrono::steady_clock;
+
+	struct history {
+		float ms[HISTORY] = {};
+		int count = 0;
+		int next = 0;
+
+		void add(float value);
+
+		stats compute() const;
+	};
+
+	struct section {
+		std::string name;
+
+		GLuint queries[BUFFERS][2] = {};
+		bool pending[BUFFERS] = {};
+		float cpuMs[BUFFERS] = {};
+
+		clock::time_point cpuStart;
+
+		history gpu;
+		history cpu;
+	};
+
+	std::vector<section> _sections;
+	std::vector<int> _open;
+
+	int _frame = 0;
+	bool _enabled = false;
+
+	int find(const char* name);
+
+	void read_back(section& s, int buffer);
+
+public:
+
+	gpu_profiler() = default;
+
+	gpu_profiler(const gpu_profiler&) = delete;
+	gpu_profiler& operator=(const gpu_profiler&) = delete;
+
+	~gpu_profiler();
+
+	//Sections are only timed while enabled
+	void setEnabled(bool enabled);
+
+	bool isEnabled() const;
+
+	//Reads back the timestamps of the previous use of this frame's buffer, call once per frame before any section
+	void begin_frame();
+
+	//Sections may nest, each begin must be matched by an end in the same frame.
+	//A section is timed at most once per frame.
+	void begin(const char* name);
+
+	void end();
+
+	//Rolling graphs with min/avg/p95/p99 of every section, in its own window
+	void draw_imgui();
+
+};
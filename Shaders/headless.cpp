@@ -0,0 +1,387 @@
+
+#if __has_include(<EGL/egl.h>)
+#define HEADLESS_EGL 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <glad/glad.h>
+#include <glfw/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_mandelbowl.h"
+#include "cpu_mandelbrot.h"
+#include "headless.h"
+#include "program_cache.h"
+#include "scene_registry.h"
+#include "screen.h"
+#include "shader.h"
+#include "shader_object.h"
+#include "tile_scheduler.h"
+
+bool parse_headless_args(int argc, const char* argv[], headless_options& opts) {
+	bool headless = false;
+
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (std::strcmp(arg, "--headless") == 0) {
+			headless = true;
+		} else if (std::strcmp(arg, "--scene") == 0 && value) {
+			opts.scene = value;
+			i++;
+		} else if (std::strcmp(arg, "--out") == 0 && value) {
+			opts.output = value;
+			i++;
+		} else if (std::strcmp(arg, "--size") == 0 && value) {
+			if (std::sscanf(value, "%dx%d", &opts.width, &opts.height) != 2)
+				std::cout << "Expected --size WIDTHxHEIGHT\n";
+			i++;
+		} else if (std::strcmp(arg, "--frames") == 0 && value) {
+			opts.frames = glm::max(std::atoi(value), 1);
+			i++;
+		} else if (std::strcmp(arg, "--cpu") == 0) {
+			opts.cpu = true;
+		} else if (std::strcmp(arg, "--threads") == 0 && value) {
+			opts.threads = glm::max(std::atoi(value), 0);
+			i++;
+		} else if (std::strcmp(arg, "--zoom") == 0 && value) {
+			opts.zoom = std::atof(value);
+			i++;
+		} else if (std::strcmp(arg, "--loc") == 0 && value) {
+			opts.hasLoc = std::sscanf(value, "%f,%f,%f", &opts.loc.x, &opts.loc.y, &opts.loc.z) == 3;
+			if (!opts.hasLoc)
+				std::cout << "Expected --loc X,Y,Z\n";
+			i++;
+		} else if (std::strcmp(arg, "--center") == 0 && value) {
+			std::string text = value;
+			size_t comma = text.find(',');
+			opts.hasCenter = comma != std::string::npos &&
+				big_fixed::parse(text.substr(0, comma).c_str(), opts.centerX) &&
+				big_fixed::parse(text.substr(comma + 1).c_str(), opts.centerY);
+			if (!opts.hasCenter)
+				std::cout << "Expected --center X,Y as decimals\n";
+			i++;
+		} else if (std::strcmp(arg, "--samples") == 0 && value) {
+			opts.samples = glm::max(std::atoi(value), 1);
+			i++;
+		}
+	}
+
+	return headless;
+}
+
+/*
+* Offscreen context, EGL where the headers exist (Mesa llvmpipe on render nodes),
+* a hidden GLFW window everywhere else
+*/
+struct headless_context {
+#ifdef HEADLESS_EGL
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	EGLSurface surface = EGL_NO_SURFACE;
+#endif
+	GLFWwindow* window = nullptr;
+
+	bool create();
+	void destroy();
+	GLADloadproc loader() const;
+};
+
+#ifdef HEADLESS_EGL
+static bool hasExtension(const char* list, const char* name) {
+	size_t len = std::strlen(name);
+	for (const char* p = list ? std::strstr(list, name) : nullptr; p; p = std::strstr(p + len, name))
+		if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+			return true;
+	return false;
+}
+#endif
+
+bool headless_context::create() {
+#ifdef HEADLESS_EGL
+	const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	//Surfaceless needs no X11 or GBM device, fall back to the default display otherwise
+	if (getPlatformDisplay && hasExtension(clientExts, "EGL_MESA_platform_surfaceless"))
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL) && eglBindAPI(EGL_OPENGL_API)) {
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+			EGL_NONE
+		};
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 6,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+		EGLConfig config = NULL;
+		EGLint count = 0;
+		bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+		eglChooseConfig(display, configAttribs, &config, 1, &count);
+
+		if (count > 0) {
+			context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+			if (!surfaceless)
+				surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+		}
+
+		//Everything is rendered into framebuffer objects, so no surface is needed when the driver allows it
+		if (context != EGL_NO_CONTEXT && (surfaceless || surface != EGL_NO_SURFACE) &&
+			eglMakeCurrent(display, surface, surface, context))
+			return true;
+
+		std::cout << "EGL context creation failed (0x" << std::hex << eglGetError() << std::dec << "), trying GLFW\n";
+		destroy();
+	}
+#endif
+
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	window = glfwCreateWindow(1, 1, "Headless", NULL, NULL);
+	if (!window) {
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+		window = glfwCreateWindow(1, 1, "Headless", NULL, NULL);
+	}
+	if (!window) {
+		glfwTerminate();
+		return false;
+	}
+
+	glfwMakeContextCurrent(window);
+	return true;
+}
+
+void headless_context::destroy() {
+#ifdef HEADLESS_EGL
+	if (display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (surface != EGL_NO_SURFACE)
+			eglDestroySurface(display, surface);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		eglTerminate(display);
+	}
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	surface = EGL_NO_SURFACE;
+#endif
+	if (window) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	window = nullptr;
+}
+
+GLADloadproc headless_context::loader() const {
+#ifdef HEADLESS_EGL
+	if (!window)
+		return (GLADloadproc)eglGetProcAddress;
+#endif
+	return (GLADloadproc)glfwGetProcAddress;
+}
+
+static bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	//GL rows start at the bottom, PPM rows at the top
+	for (int y = height - 1; y >= 0; y--)
+		file.write((const char*)&rgb[(size_t)y * width * 3], (std::streamsize)width * 3);
+
+	return (bool)file;
+}
+
+static int run_cpu(const headless_options& opts, scene_registry& scenes, int index) {
+	tile_scheduler scheduler(opts.threads);
+
+	//The GPU scenes and their windowed CPU counterparts share a renderer
+	std::string name = scenes.getName(index);
+	std::unique_ptr<cpu_renderer> renderer;
+	std::string label;
+	if (name.rfind("Mandelbrot", 0) == 0) {
+		renderer = std::make_unique<cpu_mandelbrot>(scheduler);
+		label = std::string("Mandelbrot (CPU, ") + cpu_mandelbrot::isa() + ")";
+	} else if (name.rfind("Mandelbowl", 0) == 0) {
+		renderer = std::make_unique<cpu_mandelbowl>(scheduler);
+		label = "Mandelbowl (CPU)";
+	} else {
+		std::cout << "Scene " << name << " has no CPU renderer\n";
+		return -1;
+	}
+
+	const Camera& camera = scenes.getCamera(index);
+	frame_globals globals{};
+	globals.cameraLoc = opts.hasLoc ? opts.loc : camera.loc;
+	globals.cameraLookAt = camera.lookAt;
+	globals.cameraUp = camera.up;
+	globals.cameraRight = camera.right;
+	globals.cameraFov = camera.fov;
+	globals.resolution = glm::vec2(opts.width, opts.height);
+	globals.cursorPos = 0.5f * globals.resolution;
+	if (opts.hasCenter)
+		globals.cameraLoc = glm::vec3(opts.centerX.toDouble(), opts.centerY.toDouble(), globals.cameraLoc.z);
+	globals.zoom = (float)glm::min(opts.zoom > 0.0 ? opts.zoom : scenes.getInputs(index).zoom, (double)FLT_MAX);
+	globals.zoomRaw = glm::log(globals.zoom);
+
+	shader_inputs inputs = scenes.getInputs(index);
+	if (opts.zoom > 0.0)
+		inputs.zoom = opts.zoom;
+	if (opts.hasLoc) {
+		inputs.centerX = big_fixed(opts.loc.x);
+		inputs.centerY = big_fixed(opts.loc.y);
+	}
+	if (opts.hasCenter) {
+		inputs.centerX = opts.centerX;
+		inputs.centerY = opts.centerY;
+	}
+	renderer->set_view(globals, inputs);
+
+	cpu_renderer::stats total;
+	for (int i = 0; i < opts.frames; i++) {
+		renderer->start(opts.width, opts.height, globals.cursorPos);
+		cpu_renderer::stats s = renderer->wait();
+		total.seconds += s.seconds;
+		total.iterations += s.iterations;
+	}
+
+	double pixels = (double)opts.width * opts.height * opts.frames;
+	std::cout << label << " " << opts.width << "x" << opts.height << " on " << scheduler.getThreadCount() << " thread(s): "
+		<< total.seconds * 1000.0 / opts.frames << " ms/frame, "
+		<< pixels / total.seconds / 1e6 << " Mpixel/s, "
+		<< total.iterations / total.seconds / 1e9 << " Giter/s\n";
+
+	if (!writePPM(opts.output, opts.width, opts.height, renderer->getImage())) {
+		std::cout << "Failed to write " << opts.output << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+int run_headless(const headless_options& opts, scene_registry& scenes) {
+	int index = scenes.find(opts.scene.c_str());
+	if (index < 0) {
+		std::cout << "Unknown scene " << opts.scene << "\n";
+		return -1;
+	}
+
+	if (opts.cpu)
+		return run_cpu(opts, scenes, index);
+
+	headless_context ctx;
+	if (!ctx.create()) {
+		std::cout << "Failed to create a headless GL context\n";
+		return -1;
+	}
+
+	if (!gladLoadGLLoader(ctx.loader())) {
+		std::cout << "Failed to initialize GLAD\n";
+		ctx.destroy();
+		return -1;
+	}
+
+	std::cout << "Headless renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n";
+
+	program_cache::init("cache");
+	shader::init_parallel_compile(ctx.loader());
+
+	int result = 0;
+
+	if (shader::init_vert()) {
+		//Scoped so GL objects are released before the context
+		screen scr;
+		scr.setResolution(glm::vec2(opts.width, opts.height));
+		scenes.resize(opts.width, opts.height);
+
+		shader_object* obj = scenes.select(index, scr.camera);
+		if (opts.zoom > 0.0) {
+			obj->get_inputs()->zoom = opts.zoom;
+			obj->get_inputs()->zoomRaw = (float)glm::log(opts.zoom);
+		}
+		if (opts.hasLoc) {
+			scr.camera.loc = opts.loc;
+			obj->get_inputs()->centerX = big_fixed(opts.loc.x);
+			obj->get_inputs()->centerY = big_fixed(opts.loc.y);
+		}
+		if (opts.hasCenter) {
+			scr.camera.loc = glm::vec3(opts.centerX.toDouble(), opts.centerY.toDouble(), scr.camera.loc.z);
+			obj->get_inputs()->centerX = opts.centerX;
+			obj->get_inputs()->centerY = opts.centerY;
+		}
+
+		if (opts.samples > 0 && obj->get_inputs()->samples > 0)
+			obj->get_inputs()->samples = opts.samples;
+
+		while (!obj->is_ready())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		glViewport(0, 0, opts.width, opts.height);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < opts.frames; i++) {
+			scr.invalidate();
+			obj->discard_cache();
+			scr.render(obj);
+		}
+
+		//Scenes rendered in the background are redrawn until their image is complete
+		while (obj->is_updating()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			scr.render(obj);
+		}
+		glFinish();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << scenes.getName(index) << " " << opts.width << "x" << opts.height << ": "
+			<< ms / opts.frames << " ms/frame over " << opts.frames << " frame(s)";
+		if (obj->get_inputs()->maxIterations > 0)
+			std::cout << ", " << obj->get_inputs()->maxIterations << " iterations max";
+		std::cout << "\n";
+
+		std::vector<unsigned char> rgb;
+		scr.read_pixels(rgb);
+		if (!writePPM(opts.output, opts.width, opts.height, rgb)) {
+			std::cout << "Failed to write " << opts.output << "\n";
+			result = -1;
+		}
+
+		scenes = scene_registry();
+	} else {
+		result = -1;
+	}
+
+	shader::destroy_vert();
+	ctx.destroy();
+	return result;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "big_fixed.h"
+
+class scene_registry;
+
+/*
+* Settings for rendering a scene offscreen without a window.
+* Enabled with --headless on the command line.
+*/
+struct headless_options {
+	std::string scene = "Mandelbowl";
+	std::string output = "render.ppm";
+	int width = 1920;
+	int height = 1080;
+
+	//Frames to render, more than one reports an average for benchmarking
+	int frames = 1;
+
+	//Render with the scene's cpu_renderer instead of OpenGL, no context is created
+	bool cpu = false;
+	int threads = 0;
+
+	//Overrides for the scene's stored zoom and camera location
+	double zoom = 0.0;
+	bool hasLoc = false;
+	glm::vec3 loc = glm::vec3(0.0f);
+
+	//Full precision 2D view center for deep zooms, defaults to loc.xy
+	bool hasCenter = false;
+	big_fixed centerX;
+	big_fixed centerY;
+
+	//Sample budget of supersampling scenes on the GPU, 0 keeps the scene's
+	int samples = 0;
+};
+
+//Fills opts from argv, returns false if --headless was not given
+bool parse_headless_args(int argc, const char* argv[], headless_options& opts);
+
+//Creates an offscreen GL 4.6 core context (EGL surfaceless or pbuffer when available,
+//otherwise a hidden GLFW window, trying OSMesa if the native context fails),
+//renders the scene into a framebuffer and writes it to opts.output as a binary PPM.
+//With opts.cpu the image is rendered on the CPU and no context is created.
+int run_headless(const headless_options& opts, scene_registry& scenes);
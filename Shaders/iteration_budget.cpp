@@ -0,0 +1,128 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "iteration_budget.h"
+
+int iteration_budget::forZoom(double zoom, int base) {
+	double octaves = std::log2(std::max(zoom, 1.0));
+	return (int)std::min(base + ITERATIONS_PER_OCTAVE * octaves, (double)MAX_ITERATIONS);
+}
+
+iteration_budget::iteration_budget(int base) : _base(base) {
+	for (histogram_buffer& h : _buffers) {
+		glGenBuffers(1, &h.buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, h.buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, (BINS + 1) * sizeof(GLuint), NULL, GL_DYNAMIC_READ);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+iteration_budget::~iteration_budget() {
+	for (histogram_buffer& h : _buffers) {
+		if (h.fence)
+			glDeleteSync(h.fence);
+		glDeleteBuffers(1, &h.buffer);
+	}
+}
+
+bool iteration_budget::tune(const GLuint* counts, int cap, double zoom) {
+	GLuint escaped = 0;
+	for (int b = 0; b < BINS; b++)
+		escaped += counts[b];
+
+	//Nothing on screen escaped, there is no boundary to resolve
+	if (escaped == 0)
+		return false;
+
+	//Samples escaping in the top eighth of the cap mean others were likely cut off just short of it
+	GLuint top = 0;
+	for (int b = BINS - BINS / 8; b < BINS; b++)
+		top += counts[b];
+
+	int next = cap;
+	if (top > std::max(escaped / 500, 4u)) {
+		next = cap * 2;
+	} else {
+		//Twice the iteration 99.9% of the escaping samples are done by
+		unsigned long long seen = 0;
+		int b = 0;
+		for (; b < BINS - 1; b++) {
+			seen += counts[b];
+			if (seen * 1000 >= escaped * 999ull)
+				break;
+		}
+
+		int needed = (int)((long long)(b + 1) * cap / BINS);
+		if (needed * 4 < cap)
+			next = needed * 2;
+	}
+
+	next = glm::clamp(next, MIN_ITERATIONS, MAX_ITERATIONS);
+	if (next == cap)
+		return false;
+
+	_scale = (double)next / forZoom(zoom, _base);
+	return true;
+}
+
+int iteration_budget::begin_frame(double zoom, bool viewChanged, bool partial) {
+	if (viewChanged) {
+		_version++;
+		_settled = false;
+	}
+
+	//The previous frame's draw is queued by now, make its atomics visible to the readback and fence it
+	histogram_buffer& last = _buffers[(_frame + BUFFERS - 1) % BUFFERS];
+	if (last.written && !last.fence) {
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		last.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	histogram_buffer& cur = _buffers[_frame % BUFFERS];
+	if (cur.fence) {
+		//A histogram the GPU is still busy with is dropped rather than waited for
+		GLenum state = glClientWaitSync(cur.fence, 0, 0);
+		bool ready = state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED;
+
+		if (ready && !cur.partial && cur.version == _version) {
+			GLuint counts[BINS + 1];
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, cur.buffer);
+			glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+
+			if (tune(counts, cur.cap, zoom)) {
+				_version++;
+				_settled = false;
+			} else {
+				_settled = true;
+			}
+		}
+
+		glDeleteSync(cur.fence);
+		cur.fence = nullptr;
+	}
+
+	_cap = glm::clamp((int)std::lround(forZoom(zoom, _base) * _scale), MIN_ITERATIONS, MAX_ITERATIONS);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, cur.buffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ESCAPE_HISTOGRAM_BINDING, cur.buffer);
+
+	cur.written = true;
+	cur.partial = partial;
+	cur.cap = _cap;
+	cur.version = _version;
+	_frame++;
+
+	return _cap;
+}
+
+bool iteration_budget::is_settled() const {
+	return _settled;
+}
+
+int iteration_budget::getCap() const {
+	return _cap;
+}
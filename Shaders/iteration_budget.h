@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Shader storage binding point of the EscapeHistogram block in data/escape_histogram.glsl
+constexpr unsigned int ESCAPE_HISTOGRAM_BINDING = 3;
+
+/*
+* Iteration cap of an escape time scene.
+* Starts from a rule on the zoom (deeper views need more iterations to
+* resolve the boundary) and is refined from a histogram of the iterations
+* sampled pixels escaped at, which the shader writes every frame. Histograms
+* are read back two frames later, so tuning never waits on the GPU.
+*/
+class iteration_budget {
+
+public:
+
+	//Bins over [0, cap), one more counts samples that never escaped
+	static constexpr int BINS = 64;
+
+	static constexpr int MIN_ITERATIONS = 64;
+	static constexpr int MAX_ITERATIONS = 1 << 20;
+
+	//Iterations added per doubling of the zoom
+	static constexpr int ITERATIONS_PER_OCTAVE = 64;
+
+private:
+
+	static constexpr int BUFFERS = 3;
+
+	struct histogram_buffer {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		bool written = false;
+		bool partial = false;
+		int cap = 0;
+		unsigned version = 0;
+	};
+
+	const int _base;
+
+	histogram_buffer _buffers[BUFFERS];
+	int _frame = 0;
+
+	//Tuned cap relative to the zoom rule
+	double _scale = 1.0;
+	int _cap = 0;
+
+	//Bumped whenever the view or the cap changes, only histograms of the current one are used
+	unsigned _version = 0;
+	bool _settled = false;
+
+	//Adjusts _scale from a histogram drawn with cap, true if the cap should change
+	bool tune(const GLuint* counts, int cap, double zoom);
+
+public:
+
+	//Cap of a view at this zoom before any tuning, base at zoom 1 and below
+	static int forZoom(double zoom, int base);
+
+	explicit iteration_budget(int base);
+
+	iteration_budget(const iteration_budget&) = delete;
+	iteration_budget& operator=(const iteration_budget&) = delete;
+
+	~iteration_budget();
+
+	//Read back the oldest histogram if the GPU is done with it, retune, then clear a
+	//histogram for this frame and bind it to ESCAPE_HISTOGRAM_BINDING. Returns the cap to draw with.
+	//Partial frames only iterate part of the view, their histogram is not tuned from.
+	int begin_frame(double zoom, bool viewChanged, bool partial = false);
+
+	//True once a histogram of the current view and cap asked for no change
+	bool is_settled() const;
+
+	int getCap() const;
+
+};
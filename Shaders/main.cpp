@@ -8,12 +8,19 @@
 #include <imgui_impl_opengl3.h>
 
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
 
+#include "cpu_mandelbowl.h"
+#include "cpu_mandelbrot.h"
+#include "cpu_scene.h"
+#include "headless.h"
 #include "mandelbowl.h"
 #include "mandelbrot.h"
+#include "program_cache.h"
+#include "scene_registry.h"
 #include "screen.h"
 #include "shader.h"
 #include "shader_inputs.h"
@@ -32,6 +39,22 @@ static int button_mask = 0;
 
 static float rotate_speed = 350.0f;
 
+//Each scroll step multiplies the zoom by exp(ZOOM_STEP)
+static const float ZOOM_STEP = 0.05f;
+
+//About where big_fixed view centers run out of fraction bits
+static const double MAX_ZOOM = 1e140;
+
+//Frames drawn after the last input so ImGui can finish hover and active states before idling
+static const int UI_SETTLE_FRAMES = 3;
+
+static bool had_input = false;
+
+//Scenes not shown for this long release their GPU resources
+static const double SCENE_IDLE_SECONDS = 30.0;
+
+static scene_registry scenes;
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
@@ -39,7 +62,8 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 void drawImGui() {
 
-	float zoom = curobj->get_inputs()->zoom;
+	int sceneIndex = scenes.getCurrentIndex();
+	double zoom = curobj->get_inputs()->zoom;
 	glm::vec3 loc = curscr->camera.loc;
 	float fov = curscr->camera.fov;
 
@@ -50,27 +74,97 @@ void drawImGui() {
 	ImGui::Begin("Shaders");
 
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+	ImGui::Text("Program cache: %d hits, %d misses", program_cache::getHits(), program_cache::getMisses());
+	if (!curobj->is_ready())
+		ImGui::Text("Compiling shaders...");
+
+	bool changeScene = false;
+	if (ImGui::BeginCombo("Scene", scenes.getName(sceneIndex))) {
+		for (int i = 0; i < scenes.size(); i++) {
+			if (ImGui::Selectable(scenes.getName(i), i == sceneIndex)) {
+				changeScene = i != sceneIndex;
+				sceneIndex = i;
+			}
+		}
+		ImGui::EndCombo();
+	}
 
-	bool changeZoom = ImGui::DragFloat("Zoom", &zoom, 0.25f, 1.0f, 10000.0f);
+	const double minZoom = 0.1;
+	bool changeZoom = ImGui::DragScalar("Zoom", ImGuiDataType_Double, &zoom, 0.25f, &minZoom, &MAX_ZOOM, "%.4g", ImGuiSliderFlags_Logarithmic);
 	bool changeLoc = ImGui::DragFloat3("Location", &loc.x, 0.01f, -10.0f, 10.0f);
 	bool changeFOV = ImGui::DragFloat("FOV", &fov, 0.01f, 0.1f, 1.75f);
 
+	//Only scenes that supersample have a sample budget
+	int samples = curobj->get_inputs()->samples;
+	bool changeSamples = samples > 0 && ImGui::SliderInt("Samples", &samples, 1, mandelbrot::MAX_SAMPLES);
+
+	//Expensive views fill in coarse to fine over several frames instead of stalling the UI
+	bool progressive = curscr->isProgressive();
+	float frameBudget = (float)curscr->getFrameBudget();
+	if (ImGui::Checkbox("Progressive", &progressive))
+		curscr->setProgressive(progressive);
+	if (progressive && ImGui::SliderFloat("Frame budget (ms)", &frameBudget, 1.0f, 33.0f))
+		curscr->setFrameBudget(frameBudget);
+
+	//Moving views drop resolution to hold the target, still ones are drawn at full size
+	bool dynamic = curscr->isDynamicResolution();
+	float targetFrame = (float)curscr->getTargetFrameTime();
+	if (ImGui::Checkbox("Dynamic resolution", &dynamic))
+		curscr->setDynamicResolution(dynamic);
+	if (dynamic) {
+		if (ImGui::SliderFloat("Target frame (ms)", &targetFrame, 4.0f, 33.0f))
+			curscr->setTargetFrameTime(targetFrame);
+		ImGui::Text("Render scale: %.2f", curscr->getRenderScale());
+	}
+
+	//Enough digits to tell neighbouring pixels apart, pass them to --center to render the view headless
+	int centerDigits = glm::max(6, (int)std::log10(zoom * curscr->getResolution().y) + 2);
+	const shader_inputs* in = curobj->get_inputs();
+	ImGui::TextWrapped("Center %s, %s", in->centerX.toString(centerDigits).c_str(), in->centerY.toString(centerDigits).c_str());
+	if (in->maxIterations > 0)
+		ImGui::Text("Iterations: %d", in->maxIterations);
+
+	gpu_profiler& profiler = curscr->getProfiler();
+	bool profile = profiler.isEnabled();
+	if (ImGui::Checkbox("Profiler", &profile))
+		profiler.setEnabled(profile);
+
+	curobj->draw_imgui();
+
 	ImGui::End();
+
+	profiler.draw_imgui();
+
 	ImGui::Render();
+
+	profiler.begin("ImGui");
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	profiler.end();
 
 	if (changeZoom) {
 		curobj->get_inputs()->zoom = zoom;
-		curobj->get_inputs()->zoomRaw = glm::log(zoom);
+		curobj->get_inputs()->zoomRaw = (float)glm::log(zoom) / ZOOM_STEP;
+		curobj->get_inputs()->dirty = true;
 	}
 
 	if (changeLoc) {
 		curscr->camera.loc = loc;
+		curobj->get_inputs()->centerX = big_fixed(loc.x);
+		curobj->get_inputs()->centerY = big_fixed(loc.y);
 	}
 
 	if (changeFOV) {
 		curscr->camera.fov = fov;
 	}
+
+	if (changeSamples) {
+		curobj->get_inputs()->samples = samples;
+		curobj->get_inputs()->dirty = true;
+	}
+
+	if (changeScene) {
+		curobj = scenes.select(sceneIndex, curscr->camera);
+	}
 }
 
 void APIENTRY glDebugOutput(GLenum source,
@@ -119,7 +213,50 @@ void APIENTRY glDebugOutput(GLenum source,
 	std::cout << std::endl;
 }
 
+void register_scenes() {
+	Camera brotCamera{};
+	brotCamera.loc = glm::vec3(0.0f, 0.0f, 1.0f);
+	brotCamera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+	brotCamera.right = glm::vec3(1.0f, 0.0f, 0.0f);
+	brotCamera.fov = 1.0;
+
+	Camera bowlCamera{};
+	bowlCamera.loc = glm::vec3(0.0f, -2.0f, 1.0f);
+	bowlCamera.lookAt = glm::vec3(0.0f);
+	bowlCamera.up = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f));
+	bowlCamera.right = glm::vec3(1.0f, 0.0f, 0.0f);
+	bowlCamera.fov = 1.0;
+
+	//Scenes are built on first selection
+	scenes.add("Mandelbrot", [](shader_inputs&& in) { return std::make_unique<mandelbrot>(std::move(in)); },
+		shader_inputs(0.0f, 0.8f, glm::log(0.8f)), brotCamera);
+	scenes.add("Mandelbowl", [](shader_inputs&& in) { return std::make_unique<mandelbowl>(std::move(in)); },
+		shader_inputs(), bowlCamera);
+
+	//Same scenes rendered on the CPU, tiles fill in around the cursor
+	scenes.add("Mandelbrot (CPU)", [](shader_inputs&& in) { return std::make_unique<cpu_scene>(std::make_unique<cpu_mandelbrot>(), std::move(in)); },
+		shader_inputs(0.0f, 0.8f, glm::log(0.8f)), brotCamera);
+	scenes.add("Mandelbowl (CPU)", [](shader_inputs&& in) { return std::make_unique<cpu_scene>(std::make_unique<cpu_mandelbowl>(), std::move(in)); },
+		shader_inputs(), bowlCamera);
+}
+
 int main(int argc, const char* argv[]) {
+	namespace fs = std::filesystem;
+
+	headless_options headless;
+	bool runHeadless = parse_headless_args(argc, argv, headless);
+	headless.output = fs::absolute(headless.output).string();
+
+	//Data files are found relative to the executable
+	fs::path data(*argv);
+	data.remove_filename();
+	fs::current_path(data);
+
+	register_scenes();
+
+	if (runHeadless)
+		return run_headless(headless, scenes);
+
 	//Initialize glfw
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -155,12 +292,6 @@ int main(int argc, const char* argv[]) {
 		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 	}
 
-	namespace fs = std::filesystem;
-	
-	fs::path data(*argv);
-	data.remove_filename();
-	fs::current_path(data);
-
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
@@ -170,27 +301,26 @@ int main(int argc, const char* argv[]) {
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init(glsl_version);
 
+	program_cache::init("cache");
+	shader::init_parallel_compile((GLADloadproc)glfwGetProcAddress);
+
 	if (!shader::init_vert())
 		return -1;
 
-	mandelbrot mandel({ 0.0f, 0.8f, glm::log(0.8f) });
-
-	mandelbowl bowl;
-
-	curobj = &bowl;
+	scenes.resize(SCR_WIDTH, SCR_HEIGHT);
 
 	screen scr;
 	scr.setResolution({SCR_WIDTH, SCR_HEIGHT});
-	scr.camera.loc = glm::vec3(0.0f, -2.0f, 1.0f);
-	scr.camera.lookAt = glm::vec3(0.0f);
-	scr.camera.up = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f));
-	scr.camera.right = glm::vec3(1.0f, 0.0f, 0.0f);
-	scr.camera.fov = 1.0;
 
 	curscr = &scr;
+	curobj = scenes.select(1, scr.camera);
+
+	if (program_cache::isEnabled())
+		std::cout << "Program cache: " << program_cache::getHits() << " hits, " << program_cache::getMisses() << " misses\n";
 
 	double time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
 	double elapsedTime = 0.0;
+	int settleFrames = UI_SETTLE_FRAMES;
 
 	while (!glfwWindowShouldClose(window)) {
 
@@ -203,61 +333,87 @@ int main(int argc, const char* argv[]) {
 
 		curobj->get_inputs()->elapsedTime = (float)elapsedTime;
 
+		curscr->getProfiler().begin_frame();
+
 		curscr->draw_screen(curobj);
 
 		drawImGui();
 
-		glfwSwapBuffers(window);
+		scenes.evict_idle(SCENE_IDLE_SECONDS);
 
-		glfwPollEvents();
+		glfwSwapBuffers(window);
 
+		//Sleep until the next event once the scene is static and ImGui has settled,
+		//the cached scene image is re-presented instead of re-rendered
+		if (settleFrames == 0 && curscr->is_current(curobj)) {
+			glfwWaitEvents();
+			settleFrames = UI_SETTLE_FRAMES;
+		} else {
+			glfwPollEvents();
+			settleFrames = had_input ? UI_SETTLE_FRAMES : glm::max(settleFrames - 1, 0);
+		}
+		had_input = false;
 	}
 
+	//Release scene GL objects while the context is still alive
+	scenes = scene_registry();
+
 	shader::destroy_vert();
 
 	//Terminate glfw
 	glfwTerminate();
 }
 
-glm::vec2 screenToWorld(glm::vec2 coord) {
-	glm::vec2 res = curscr->getResolution();
-	return (2.0f * coord - res) / (res.y * curobj->get_inputs()->zoom) + glm::vec2(curscr->camera.loc);
+//Offsets are computed in double and added to the big_fixed center, so they stay exact at any zoom
+glm::dvec2 screenToView(glm::vec2 coord) {
+	glm::dvec2 res = curscr->getResolution();
+	return (2.0 * glm::dvec2(coord) - res) / (res.y * curobj->get_inputs()->zoom);
 }
 
-glm::vec2 screenToWorldDir(glm::vec2 dir) {
-	glm::vec2 res = curscr->getResolution();
-	return 2.0f * dir / (res.y * curobj->get_inputs()->zoom);
+glm::dvec2 screenToWorldDir(glm::vec2 dir) {
+	glm::dvec2 res = curscr->getResolution();
+	return 2.0 * glm::dvec2(dir) / (res.y * curobj->get_inputs()->zoom);
 }
 
-glm::vec2 worldToScreen(glm::vec2 coord) {
-	glm::vec2 res = curscr->getResolution();
-	return ((coord - glm::vec2(curscr->camera.loc)) * (res.y * curobj->get_inputs()->zoom) + res) / 2.0f;
+void moveCenter(glm::dvec2 offset) {
+	shader_inputs* curin = curobj->get_inputs();
+	curin->centerX += big_fixed(offset.x);
+	curin->centerY += big_fixed(offset.y);
+
+	//Past float precision camera.loc stops changing, the center still moved
+	curin->dirty = true;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+	had_input = true;
+
 	glViewport(0, 0, width, height);
 	curscr->setResolution({width, height});
+	scenes.resize(width, height);
 }
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+	had_input = true;
+
 	glm::vec2 res = curscr->getResolution();
 	//Flip the y because rendering is done from lower left and cursor is from upper left
 	glm::vec2 new_pos = glm::vec2((float)xpos, res.y - (float)ypos);
 
 	glm::vec2 old_pos = curscr->getCursorPos();
-	glm::vec2 s_dir = screenToWorldDir(new_pos - old_pos);
+	glm::dvec2 s_dir = screenToWorldDir(new_pos - old_pos);
 
 	if (button_mask & PAN_BUTTON_MASK) {
 		//Pan the camera in reference to current camera plane
-		glm::vec3 x_dir = curscr->camera.right * s_dir.x;
-		glm::vec3 y_dir = curscr->camera.up * s_dir.y;
-		glm::vec3 n_dir = x_dir + y_dir;
-		curscr->camera.loc -= n_dir;
-		curscr->camera.lookAt -= n_dir;
+		glm::dvec3 x_dir = glm::dvec3(curscr->camera.right) * s_dir.x;
+		glm::dvec3 y_dir = glm::dvec3(curscr->camera.up) * s_dir.y;
+		glm::dvec3 n_dir = x_dir + y_dir;
+		curscr->camera.loc -= glm::vec3(n_dir);
+		curscr->camera.lookAt -= glm::vec3(n_dir);
+		moveCenter(-glm::dvec2(n_dir));
 	} else if (button_mask & ROTATE_BUTTON_MASK) {
 		//Arcball rotation around camera's lookAt point
-		float x_scale = -s_dir.x / res.x * rotate_speed * 2.0f;
-		float y_scale = s_dir.y / res.y * rotate_speed * 2.0f;
+		float x_scale = (float)-s_dir.x / res.x * rotate_speed * 2.0f;
+		float y_scale = (float)s_dir.y / res.y * rotate_speed * 2.0f;
 		float x_sin_half = glm::sin(x_scale / 2);
 		float y_sin_half = glm::sin(y_scale / 2);
 		float x_cos_half = glm::cos(x_scale / 2);
@@ -279,20 +435,24 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+	had_input = true;
+
 	glm::vec2 curpos = curscr->getCursorPos();
-	glm::vec2 pos = screenToWorld(curpos);
+	glm::dvec2 before = screenToView(curpos);
 
 	shader_inputs* curin = curobj->get_inputs();
 
-	curin->zoomRaw += (float)yoffset;
-	curin->zoom = glm::exp(0.05f * curin->zoomRaw);
+	curin->zoomRaw = glm::min(curin->zoomRaw + (float)yoffset, (float)glm::log(MAX_ZOOM) / ZOOM_STEP);
+	curin->zoom = glm::exp((double)ZOOM_STEP * curin->zoomRaw);
 
-	glm::vec2 new_cursorPos = worldToScreen(pos);
-	curscr->camera.loc += glm::vec3(screenToWorldDir(new_cursorPos - curpos), 0.0f);
+	//Keep the point under the cursor in place
+	glm::dvec2 shift = before - screenToView(curpos);
+	curscr->camera.loc += glm::vec3(glm::vec2(shift), 0.0f);
+	moveCenter(shift);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-
+	had_input = true;
 
 	if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
 		if (action == GLFW_PRESS)
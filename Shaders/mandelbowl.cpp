@@ -3,77 +3,68 @@
 
 #include <iostream>
 
+#include "iteration_budget.h"
 #include "mandelbowl.h"
 
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
-void mandelbowl::init() {
-	glGenTextures(1, &_inputs.partTexture);
-	glGenTextures(1, &_inputs.normTexture);
-	glGenTextures(1, &_inputs.maskTexture);
-
-	glBindTexture(GL_TEXTURE_2D, _inputs.partTexture);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+static const GLfloat FIELD_QUAD[] = {
+	-1.0f, -1.0f, 0.0f,
+	 1.0f, -1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	 1.0f,  1.0f, 0.0f,
+};
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8I, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED_INTEGER, GL_BYTE, NULL);
+void mandelbowl::init() {
+	glGenTextures(1, &_inputs.gbufferTexture);
+	glGenTextures(1, &_coneTexture);
 
-	glBindTexture(GL_TEXTURE_2D, _inputs.normTexture);
+	glBindTexture(GL_TEXTURE_2D, _coneTexture);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, (SCR_WIDTH + CONE_TILE - 1) / CONE_TILE, (SCR_HEIGHT + CONE_TILE - 1) / CONE_TILE, 0, GL_RG, GL_FLOAT, NULL);
 
-	glBindTexture(GL_TEXTURE_2D, _inputs.maskTexture);
+	glBindTexture(GL_TEXTURE_2D, _inputs.gbufferTexture);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8I, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED_INTEGER, GL_BYTE, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, NULL);
 
-	glGenFramebuffers(1, &_partFB);
-	glGenFramebuffers(1, &_normFB);
+	glGenFramebuffers(1, &_coneFB);
+	glGenFramebuffers(1, &_gbufferFB);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, _partFB);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.partTexture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, _coneFB);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _coneTexture, 0);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
 
-	glBindFramebuffer(GL_FRAMEBUFFER, _normFB);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.normTexture, 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, _inputs.maskTexture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, _gbufferFB);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.gbufferTexture, 0);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	_normShader.use();
-	glUniform1i(glGetUniformLocation(_normShader.getProgram(), "part_tex"), 0);
-
-	GLuint mprog = this->use_main_program();
-	glUniform1i(glGetUniformLocation(mprog, "part_tex"), 0);
-	glUniform1i(glGetUniformLocation(mprog, "norm_tex"), 1);
-	glUniform1i(glGetUniformLocation(mprog, "mask_tex"), 2);
+	//Sampler units come from layout(binding) in the shaders, so nothing here has to wait on a link
 }
 
-mandelbowl::mandelbowl() : shader_object("data/mandelbowl.glsl"),
-	_partShader("data/mandelbowl_parts.glsl"), _normShader("data/mandelbowl_normals.glsl") {
+mandelbowl::mandelbowl() : shader_object("data/mandelbowl.glsl", GL_COMPUTE_SHADER), _coneShader("data/mandelbowl_cones.glsl"),
+	_normShader("data/mandelbowl_normals.glsl"), _fieldShader("data/mandelbowl_field.glsl") {
 	init();
 }
 
-mandelbowl::mandelbowl(shader_inputs&& inputs) : shader_object("data/mandelbowl.glsl"),
-	_partShader("data/mandelbowl_parts.glsl"), _normShader("data/mandelbowl_normals.glsl") {
+mandelbowl::mandelbowl(shader_inputs&& inputs) : shader_object("data/mandelbowl.glsl", GL_COMPUTE_SHADER), _coneShader("data/mandelbowl_cones.glsl"),
+	_normShader("data/mandelbowl_normals.glsl"), _fieldShader("data/mandelbowl_field.glsl") {
 	init();
 	_inputs.elapsedTime = inputs.elapsedTime;
 	_inputs.zoom = inputs.zoom;
@@ -81,11 +72,64 @@ mandelbowl::mandelbowl(shader_inputs&& inputs) : shader_object("data/mandelbowl.
 }
 
 mandelbowl::~mandelbowl() {
-	glDeleteTextures(1, &_inputs.partTexture);
-	glDeleteTextures(1, &_inputs.normTexture);
-	glDeleteTextures(1, &_inputs.maskTexture);
-	glDeleteFramebuffers(1, &_partFB);
-	glDeleteFramebuffers(1, &_normFB);
+	glDeleteTextures(1, &_inputs.gbufferTexture);
+	glDeleteTextures(1, &_fieldTexture);
+	glDeleteTextures(1, &_coneTexture);
+	glDeleteFramebuffers(1, &_coneFB);
+	glDeleteFramebuffers(1, &_gbufferFB);
+}
+
+bool mandelbowl::is_ready() {
+	//Poll every program so each one finishes (and is cached) as soon as the driver is done
+	bool cone = _coneShader.poll();
+	bool norm = _normShader.poll();
+	bool field = _fieldShader.poll();
+	bool main = shader_object::is_ready();
+	return cone && norm && field && main;
+}
+
+void mandelbowl::build_field() {
+	glGenTextures(1, &_fieldTexture);
+	glBindTexture(GL_TEXTURE_2D, _fieldTexture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, FIELD_WIDTH, FIELD_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+
+	GLuint fb;
+	glGenFramebuffers(1, &fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _fieldTexture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
+
+	//Drawn before the screen binds its quad and viewport for the frame, so it brings its own
+	GLuint vao, vbo;
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(FIELD_QUAD), FIELD_QUAD, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glViewport(0, 0, FIELD_WIDTH, FIELD_HEIGHT);
+	_fieldShader.use();
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fb);
+
+	_fieldBuilt = true;
 }
 
 shader_inputs* mandelbowl::get_inputs() {
@@ -103,30 +147,25 @@ int mandelbowl::input_shaders_count() const {
 GLuint mandelbowl::setup_input_shader(const int index) {
 
 	switch (index) {
+		//Every pass writes all of its pixels, nothing is cleared so tiles drawn in earlier frames are kept
 		case 0:
 		{
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, _inputs.partTexture);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, _inputs.normTexture);
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, _inputs.maskTexture);
+			//A texel per tile, progressive tiles are scissored in pixels so the first of them already cover all texels
+			glm::ivec2 size = (_passSize + CONE_TILE - 1) / CONE_TILE;
+			glViewport(0, 0, size.x, size.y);
 
-			glDisable(GL_DITHER);
-
-			glBindFramebuffer(GL_FRAMEBUFFER, _partFB);
-			glClear(GL_COLOR_BUFFER_BIT);
-			_partShader.use();
-			return _partShader.getProgram();
+			glBindFramebuffer(GL_FRAMEBUFFER, _coneFB);
+			_coneShader.use();
+			return _coneShader.getProgram();
 		}
 		case 1:
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, _normFB);
-			glClear(GL_COLOR_BUFFER_BIT);
-			_normShader.use();
-
-			glEnable(GL_DITHER);
+			//Dithering would scramble the part and mask packed into the G-buffer
+			glViewport(0, 0, _passSize.x, _passSize.y);
+			glDisable(GL_DITHER);
 
+			glBindFramebuffer(GL_FRAMEBUFFER, _gbufferFB);
+			_normShader.use();
 			return _normShader.getProgram();
 		}
 		default:
@@ -136,48 +175,70 @@ GLuint mandelbowl::setup_input_shader(const int index) {
 	}
 }
 
+const char* mandelbowl::pass_name(const int index) const {
+	static const char* NAMES[] = { "Cones", "Geometry", "Composite" };
+	return NAMES[glm::clamp(index, 0, 2)];
+}
+
 void mandelbowl::framebuffer_resize(int width, int height) {
-	glDeleteTextures(1, &_inputs.partTexture);
-	glDeleteTextures(1, &_inputs.normTexture);
-	glDeleteTextures(1, &_inputs.maskTexture);
+	glDeleteTextures(1, &_inputs.gbufferTexture);
+	glDeleteTextures(1, &_coneTexture);
 
-	glGenTextures(1, &_inputs.partTexture);
-	glGenTextures(1, &_inputs.normTexture);
-	glGenTextures(1, &_inputs.maskTexture);
+	glGenTextures(1, &_inputs.gbufferTexture);
+	glGenTextures(1, &_coneTexture);
 
-	glBindTexture(GL_TEXTURE_2D, _inputs.partTexture);
+	glBindTexture(GL_TEXTURE_2D, _coneTexture);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8I, width, height, 0, GL_RED_INTEGER, GL_BYTE, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, (width + CONE_TILE - 1) / CONE_TILE, (height + CONE_TILE - 1) / CONE_TILE, 0, GL_RG, GL_FLOAT, NULL);
 
-	glBindTexture(GL_TEXTURE_2D, _inputs.normTexture);
+	glBindTexture(GL_TEXTURE_2D, _inputs.gbufferTexture);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, NULL);
 
-	glBindTexture(GL_TEXTURE_2D, _inputs.maskTexture);
+	glBindFramebuffer(GL_FRAMEBUFFER, _coneFB);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _coneTexture, 0);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, _gbufferFB);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.gbufferTexture, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool mandelbowl::is_progressive() const {
+	return true;
+}
+
+GLuint mandelbowl::upscale_guide(glm::vec4& weights) const {
+	//Octahedral normals about 30 degrees apart, or a different mask or part
+	weights = glm::vec4(36.0f, 36.0f, 16.0f, 64.0f);
+	return _inputs.gbufferTexture;
+}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8I, width, height, 0, GL_RED_INTEGER, GL_BYTE, NULL);
+void mandelbowl::bind_textures() {
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _inputs.gbufferTexture);
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, _fieldTexture);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, _coneTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, _partFB);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.partTexture, 0);
+void mandelbowl::prepare_frame(const frame_globals& globals) {
+	if (!_fieldBuilt)
+		build_field();
 
-	glBindFramebuffer(GL_FRAMEBUFFER, _normFB);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _inputs.normTexture, 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, _inputs.maskTexture, 0);
+	_passSize = glm::ivec2(globals.resolution);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	_inputs.maxIterations = iteration_budget::forZoom(_inputs.zoom, BASE_ITERATIONS);
 }
@@ -8,25 +8,47 @@
 class mandelbowl : public shader_object {
 
 	struct mandelbowl_inputs : public shader_inputs {
-		GLuint partTexture = 0;
-		GLuint normTexture = 0;
-		GLuint maskTexture = 0;
+		//Normal, part and mask of every pixel, laid out as in data/mandelbowl_gbuffer.glsl
+		GLuint gbufferTexture = 0;
 
 		mandelbowl_inputs() { }
 
 	};
 
-	shader _partShader;
+	shader _coneShader;
 	shader _normShader;
+	shader _fieldShader;
 	mandelbowl_inputs _inputs;
 
-	GLuint _partFB;
-	GLuint _normFB;
+	//Distance to the surface over (x, length(yz)), built once and marched through by the normal pass
+	GLuint _fieldTexture = 0;
+	bool _fieldBuilt = false;
+
+	//Depth range each tile of CONE_TILE pixels is empty over, the normal pass starts its rays past it
+	GLuint _coneTexture = 0;
+	GLuint _coneFB;
+
+	GLuint _gbufferFB;
+
+	//Size of the passes this frame, the cone pass draws into a smaller viewport
+	glm::ivec2 _passSize = glm::ivec2(0);
 
 	void init();
 
+	void build_field();
+
 public:
 
+	//Iteration cap of distanceToMandelbrot at zoom 1, more pixels on the surface need more below that
+	static constexpr int BASE_ITERATIONS = 300;
+
+	//Texels of the distance field over x in [-2, 2] and r in [0, 1.25], must match data/mandelbowl_distance.glsl
+	static constexpr int FIELD_WIDTH = 2048;
+	static constexpr int FIELD_HEIGHT = 640;
+
+	//Pixels per side of a tile of the cone pass, must match data/mandelbowl_cones.glsl
+	static constexpr int CONE_TILE = 8;
+
 	mandelbowl();
 	
 	mandelbowl(shader_inputs&& inputs);
@@ -41,7 +63,20 @@ public:
 
 	GLuint setup_input_shader(const int index) override;
 
+	const char* pass_name(const int index) const override;
+
 	void framebuffer_resize(int width, int height) override;
 
+	bool is_ready() override;
+
+	bool is_progressive() const override;
+
+	//The G-buffer, upscaling keeps silhouettes and creases sharp
+	GLuint upscale_guide(glm::vec4& weights) const override;
+
+	void prepare_frame(const frame_globals& globals) override;
+
+	void bind_textures() override;
+
 };
 
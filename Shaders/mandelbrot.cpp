@@ -1,13 +1,111 @@
 #include <glad/glad.h>
 
+#include <imgui.h>
+
+#include <iostream>
+
 #include "mandelbrot.h"
 
-mandelbrot::mandelbrot() : shader_object("data/mandelbrot.glsl") {
+//Channel phases of the cosine palettes, the first is the original coloring
+static const char* PALETTE_NAMES[] = { "Classic", "Ember", "Ocean", "Mono" };
+static const glm::vec3 PALETTE_PHASES[] = {
+	glm::vec3(0.0f, 0.6f, 1.0f),
+	glm::vec3(0.0f, 1.0f, 2.0f),
+	glm::vec3(3.0f, 2.2f, 1.5f),
+	glm::vec3(0.0f),
+};
+
+static void createEscapeTarget(GLuint& texture, GLuint& fb, glm::ivec2 size) {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, size.x, size.y, 0, GL_RGBA, GL_FLOAT, NULL);
+
+	glGenFramebuffers(1, &fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void mandelbrot::mandelbrot_inputs::upload(ring_buffer& frame) const {
+	orbit.upload(frame, pixelScale);
+	bla.upload(frame);
+	frame.push(GL_UNIFORM_BUFFER, MANDELBROT_COLORING_BINDING, &colors, sizeof(coloring));
+	frame.push(GL_UNIFORM_BUFFER, MANDELBROT_REUSE_BINDING, &reused, sizeof(reuse));
+}
+
+mandelbrot::mandelbrot() : shader_object("data/mandelbrot.glsl"),
+	_sampleShader("data/mandelbrot_samples.glsl"), _refineShader("data/mandelbrot_refine.glsl"),
+	_reprojectShader("data/mandelbrot_reproject.glsl"), _budget(BASE_ITERATIONS) {
+	_inputs.samples = DEFAULT_SAMPLES;
+}
+
+mandelbrot::mandelbrot(shader_inputs&& inputs) : shader_object("data/mandelbrot.glsl"), _inputs(inputs),
+	_sampleShader("data/mandelbrot_samples.glsl"), _refineShader("data/mandelbrot_refine.glsl"),
+	_reprojectShader("data/mandelbrot_reproject.glsl"), _budget(BASE_ITERATIONS) {
+	_inputs.samples = _inputs.samples > 0 ? glm::min(_inputs.samples, MAX_SAMPLES) : DEFAULT_SAMPLES;
+}
+
+mandelbrot::~mandelbrot() {
+	glDeleteTextures(2, _sampleTexture);
+	glDeleteTextures(2, _escapeTexture);
+	glDeleteFramebuffers(2, _sampleFB);
+	glDeleteFramebuffers(2, _escapeFB);
+}
+
+bool mandelbrot::is_ready() {
+	//Poll every program so each one finishes (and is cached) as soon as the driver is done
+	bool samples = _sampleShader.poll();
+	bool refine = _refineShader.poll();
+	bool reproject = _reprojectShader.poll();
+	bool main = shader_object::is_ready();
+	return samples && refine && reproject && main;
+}
+
+void mandelbrot::ensure_escape_targets(glm::ivec2 size) {
+	if (size == _escapeSize && _escapeFB[0])
+		return;
+
+	glDeleteTextures(2, _sampleTexture);
+	glDeleteTextures(2, _escapeTexture);
+	glDeleteFramebuffers(2, _sampleFB);
+	glDeleteFramebuffers(2, _escapeFB);
 
+	for (int i = 0; i < 2; i++) {
+		createEscapeTarget(_sampleTexture[i], _sampleFB[i], size);
+		createEscapeTarget(_escapeTexture[i], _escapeFB[i], size);
+	}
+
+	_escapeSize = size;
+	_escapeValid = false;
 }
 
-mandelbrot::mandelbrot(shader_inputs&& inputs) : shader_object("data/mandelbrot.glsl"), _inputs(std::move(inputs)) {
+void mandelbrot::scroll_escape_targets(glm::ivec2 offset) {
+	//Pixel p of the new view is pixel p + offset of the old one
+	glm::ivec2 src = glm::max(offset, 0);
+	glm::ivec2 dst = glm::max(-offset, 0);
+	glm::ivec2 extent = _escapeSize - glm::abs(offset);
+	int next = 1 - _current;
+
+	glCopyImageSubData(_sampleTexture[_current], GL_TEXTURE_2D, 0, src.x, src.y, 0,
+		_sampleTexture[next], GL_TEXTURE_2D, 0, dst.x, dst.y, 0, extent.x, extent.y, 1);
+	glCopyImageSubData(_escapeTexture[_current], GL_TEXTURE_2D, 0, src.x, src.y, 0,
+		_escapeTexture[next], GL_TEXTURE_2D, 0, dst.x, dst.y, 0, extent.x, extent.y, 1);
+
+	_current = next;
+	_inputs.reused.keptPixels = glm::ivec4(dst, dst + extent);
+}
 
+void mandelbrot::reproject_escape_targets(double oldZoom, glm::dvec2 oldOffset) {
+	//The reprojection pass reads the old records (bind_textures) and writes the other targets
+	_current = 1 - _current;
+	_inputs.reused.keptPixels = glm::ivec4(0);
+	_inputs.reused.reprojection = glm::vec4((float)(oldZoom / _inputs.zoom), 0.0f, glm::vec2(oldOffset));
 }
 
 shader_inputs* mandelbrot::get_inputs() {
@@ -15,13 +113,176 @@ shader_inputs* mandelbrot::get_inputs() {
 }
 
 bool mandelbrot::has_input_shaders() const {
-	return false;
+	return true;
 }
 
 int mandelbrot::input_shaders_count() const {
-	return 0;
+	if (_preview)
+		return 1;
+	return _iterate ? 2 : 0;
 }
 
 GLuint mandelbrot::setup_input_shader(const int index) {
-	return 0;
-}
\ No newline at end of file
+	if (_preview) {
+		glBindFramebuffer(GL_FRAMEBUFFER, _escapeFB[_current]);
+		_reprojectShader.use();
+		return _reprojectShader.getProgram();
+	}
+
+	switch (index) {
+		case 0:
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, _sampleFB[_current]);
+			_sampleShader.use();
+			return _sampleShader.getProgram();
+		}
+		case 1:
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, _escapeFB[_current]);
+			_refineShader.use();
+			return _refineShader.getProgram();
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+const char* mandelbrot::pass_name(const int index) const {
+	if (index == input_shaders_count())
+		return "Coloring";
+	if (_preview)
+		return "Reproject";
+	return index == 0 ? "Samples" : "Refine";
+}
+
+bool mandelbrot::reads_time() const {
+	return _inputs.colors.cycleSpeed != 0.0f;
+}
+
+bool mandelbrot::is_progressive() const {
+	return true;
+}
+
+GLuint mandelbrot::upscale_guide(glm::vec4& weights) const {
+	//Smooth iteration counts a band apart, or a different fraction of samples escaping
+	weights = glm::vec4(1.0f, 0.0f, 0.0f, 16.0f);
+	return _escapeTexture[_current];
+}
+
+bool mandelbrot::is_updating() const {
+	return !_budget.is_settled() || _previewShown;
+}
+
+void mandelbrot::discard_cache() {
+	_escapeValid = false;
+	_previewShown = false;
+}
+
+void mandelbrot::prepare_frame(const frame_globals& globals) {
+	bool viewChanged = glm::vec2(globals.cameraLoc) != _viewLoc || globals.resolution != _viewResolution ||
+		_inputs.zoom != _viewZoom || _inputs.centerX != _viewX || _inputs.centerY != _viewY;
+
+	//Only the center moved, in pixels of the view. Shallow views are drawn around the float camera, deep ones around the center.
+	bool panned = viewChanged && globals.resolution == _viewResolution && _inputs.zoom == _viewZoom;
+	glm::dvec2 pan = glm::dvec2(0.0);
+	if (panned) {
+		double pixels = 0.5 * globals.resolution.y * _inputs.zoom;
+		if (_inputs.zoom < DEEP_ZOOM)
+			pan = (glm::dvec2(glm::vec2(globals.cameraLoc)) - glm::dvec2(_viewLoc)) * pixels;
+		else
+			pan = glm::dvec2((_inputs.centerX - _viewX).toDouble(), (_inputs.centerY - _viewY).toDouble()) * pixels;
+	}
+
+	//The zoom changed, a preview only needs the old view's offset in its own pixels
+	bool zoomed = viewChanged && globals.resolution == _viewResolution && _inputs.zoom != _viewZoom;
+	double oldZoom = _viewZoom;
+	glm::dvec2 oldOffset = glm::dvec2((_inputs.centerX - _viewX).toDouble(), (_inputs.centerY - _viewY).toDouble()) *
+		(0.5 * globals.resolution.y * _viewZoom);
+
+	_viewLoc = glm::vec2(globals.cameraLoc);
+	_viewResolution = globals.resolution;
+	_viewZoom = _inputs.zoom;
+	_viewX = _inputs.centerX;
+	_viewY = _inputs.centerY;
+
+	ensure_escape_targets(glm::ivec2(globals.resolution));
+
+	//Wheel zooms show the old records stretched to the new scale at once, and are iterated once the zoom holds still
+	bool previewed = _previewShown;
+	_preview = zoomed && (_escapeValid || previewed);
+	_previewShown = _preview;
+	if (_preview) {
+		reproject_escape_targets(oldZoom, oldOffset);
+		_escapeValid = false;
+		_iterate = false;
+		return;
+	}
+
+	//Only palette edits since the last frame, recolor the records already there
+	_iterate = viewChanged || !_escapeValid || _inputs.samples != _escapeSamples || !_budget.is_settled();
+
+	//A pan by whole pixels of a finished image keeps the overlap, only the exposed strips are iterated
+	glm::ivec2 offset = glm::ivec2(glm::round(pan));
+	glm::dvec2 drift = _panDrift + pan - glm::dvec2(offset);
+	bool reuse = panned && _escapeValid && _inputs.samples == _escapeSamples && _budget.is_settled() &&
+		glm::all(glm::lessThan(glm::abs(offset), _escapeSize)) && glm::all(glm::lessThanEqual(glm::abs(drift), glm::dvec2(MAX_PAN_DRIFT)));
+
+	if (reuse) {
+		scroll_escape_targets(offset);
+		_panDrift = drift;
+	} else if (_iterate) {
+		_inputs.reused.keptPixels = glm::ivec4(0);
+		_panDrift = glm::dvec2(0.0);
+	}
+
+	if (!_iterate)
+		return;
+
+	_escapeValid = true;
+	_escapeSamples = _inputs.samples;
+
+	//The cap of a reused image still holds, a pan alone does not restart tuning
+	_inputs.maxIterations = _budget.begin_frame(_inputs.zoom, (viewChanged || previewed) && !reuse, reuse);
+
+	if (_inputs.zoom < DEEP_ZOOM) {
+		_inputs.orbit.clear();
+		_inputs.bla.clear();
+		_inputs.pixelScale = 0.0;
+		return;
+	}
+
+	_inputs.pixelScale = 1.0 / (globals.resolution.y * _inputs.zoom);
+
+	//Zooming without moving the center reuses the orbit, the table depends on the view size
+	double dcMax = _inputs.pixelScale * glm::length(glm::dvec2(globals.resolution) + 1.0);
+	if (_inputs.orbit.compute(_inputs.centerX, _inputs.centerY, _inputs.maxIterations) || dcMax != _inputs.bla.getDcMax())
+		_inputs.bla.build(_inputs.orbit, dcMax);
+}
+
+void mandelbrot::bind_textures() {
+	//The refine or reprojection pass reads unit 0, the coloring pass unit 1
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _preview ? _escapeTexture[1 - _current] : _sampleTexture[_current]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, _escapeTexture[_current]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void mandelbrot::draw_imgui() {
+	coloring& c = _inputs.colors;
+
+	bool changed = false;
+	if (ImGui::Combo("Palette", &_inputs.palette, PALETTE_NAMES, IM_ARRAYSIZE(PALETTE_NAMES))) {
+		c.channelPhase = PALETTE_PHASES[_inputs.palette];
+		changed = true;
+	}
+	changed |= ImGui::DragFloat("Density", &c.density, 0.002f, 0.001f, 2.0f);
+	changed |= ImGui::DragFloat("Phase", &c.phase, 0.01f, 0.0f, 6.2832f);
+	changed |= ImGui::DragFloat("Cycle speed", &c.cycleSpeed, 0.01f, -10.0f, 10.0f);
+	changed |= ImGui::SliderFloat("Boundary shading", &c.shading, 0.0f, 1.0f);
+
+	if (changed)
+		_inputs.dirty = true;
+}
@@ -2,29 +2,159 @@
 
 #include <glad/glad.h>
 
+#include "bla_table.h"
+#include "iteration_budget.h"
+#include "reference_orbit.h"
 #include "shader_object.h"
 
+//Uniform buffer binding point of the MandelbrotColoring block in data/mandelbrot.glsl
+constexpr unsigned int MANDELBROT_COLORING_BINDING = 1;
+
+//Uniform buffer binding point of the MandelbrotReuse block in data/mandelbrot_reuse.glsl
+constexpr unsigned int MANDELBROT_REUSE_BINDING = 2;
+
 class mandelbrot : public shader_object {
 
-	shader_inputs _inputs;
+public:
+
+	//CPU mirror of the std140 MandelbrotColoring block
+	struct coloring {
+		glm::vec3 channelPhase = glm::vec3(0.0f, 0.6f, 1.0f);
+		float density = 0.15f;
+		float phase = 3.0f;
+		float cycleSpeed = 0.0f;
+		float shading = 0.0f;
+		float _pad = 0.0f;
+	};
+
+	static_assert(sizeof(coloring) == 32, "coloring must match the std140 MandelbrotColoring block");
+
+	//CPU mirror of the std140 MandelbrotReuse block
+	struct reuse {
+		//x0, y0, x1, y1 of the pixels copied from the previous frame, the iteration passes skip them
+		glm::ivec4 keptPixels = glm::ivec4(0);
+		//Old pixels per new pixel in x, offset of the old view in old pixels in zw
+		glm::vec4 reprojection = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	};
+
+	static_assert(sizeof(reuse) == 32, "reuse must match the std140 MandelbrotReuse block");
+
+private:
+
+	struct mandelbrot_inputs : public shader_inputs {
+		reference_orbit orbit;
+		bla_table bla;
+		double pixelScale = 0.0;
+
+		int palette = 0;
+		coloring colors;
+		reuse reused;
+
+		mandelbrot_inputs() { }
+
+		mandelbrot_inputs(const shader_inputs& inputs) : shader_inputs(inputs) { }
+
+		void upload(ring_buffer& frame) const override;
+
+	};
+
+	mandelbrot_inputs _inputs;
+
+	//Escape records of one sample per pixel, then of the refined image the coloring pass reads.
+	//Two of each, a pan copies what is still on screen from the current ones into the others.
+	shader _sampleShader;
+	shader _refineShader;
+	shader _reprojectShader;
+	GLuint _sampleTexture[2] = {};
+	GLuint _escapeTexture[2] = {};
+	GLuint _sampleFB[2] = {};
+	GLuint _escapeFB[2] = {};
+	int _current = 0;
+	glm::ivec2 _escapeSize = glm::ivec2(0);
+
+	//Sub pixel error of the pans reused since the records were last iterated in full
+	glm::dvec2 _panDrift = glm::dvec2(0.0);
+
+	//False once the escape records no longer match the view, the iteration passes then run again
+	bool _escapeValid = false;
+	bool _iterate = true;
+
+	//The current escape records are a zoom preview stretched from the previous view, iterated next frame
+	bool _preview = false;
+	bool _previewShown = false;
+	int _escapeSamples = 0;
+
+	iteration_budget _budget;
+
+	//View the iteration cap was last tuned for
+	glm::vec2 _viewLoc = glm::vec2(0.0f);
+	glm::vec2 _viewResolution = glm::vec2(0.0f);
+	double _viewZoom = 0.0;
+	big_fixed _viewX;
+	big_fixed _viewY;
+
+	void ensure_escape_targets(glm::ivec2 size);
+
+	//Copies the records still on screen after a pan of offset pixels into the other targets and makes them current
+	void scroll_escape_targets(glm::ivec2 offset);
+
+	//Sets up the reprojection of the current records from the old view into the other targets and makes them current
+	void reproject_escape_targets(double oldZoom, glm::dvec2 oldOffset);
 
 public:
 
+	//Past this zoom float coordinates start to show blocks, pixels are then
+	//iterated as double offsets from a reference orbit at the view center
+	static constexpr double DEEP_ZOOM = 1e4;
+
+	//Iteration cap at zoom 1, iteration_budget raises it with the zoom and tunes it per frame
+	static constexpr int BASE_ITERATIONS = 512;
+
+	//Samples per pixel at detailed pixels, flat regions take one
+	static constexpr int DEFAULT_SAMPLES = 4;
+	static constexpr int MAX_SAMPLES = 16;
+
+	//Pans off the pixel grid by more than this are iterated in full
+	static constexpr double MAX_PAN_DRIFT = 0.25;
+
 	mandelbrot();
 
 	mandelbrot(shader_inputs&& inputs);
 
-	~mandelbrot() override = default;
+	~mandelbrot() override;
 
 	shader_inputs* get_inputs() override;
 
 	bool has_input_shaders() const override;
 
+	//The iteration passes, the reprojection pass on a zoom preview, none while the escape records still match the view
 	int input_shaders_count() const override;
 
 	GLuint setup_input_shader(const int index) override;
 
+	const char* pass_name(const int index) const override;
+
 	void framebuffer_resize(int width, int height) { }
 
-};
+	bool is_ready() override;
 
+	//Color cycling animates the palette, only the coloring pass is redrawn
+	bool reads_time() const override;
+
+	//Redrawn until the iteration cap stops changing and after a zoom preview
+	bool is_updating() const override;
+
+	bool is_progressive() const override;
+
+	//The escape records, upscaling keeps color bands and the set boundary sharp
+	GLuint upscale_guide(glm::vec4& weights) const override;
+
+	void discard_cache() override;
+
+	void prepare_frame(const frame_globals& globals) override;
+
+	void bind_textures() override;
+
+	void draw_imgui() override;
+
+};
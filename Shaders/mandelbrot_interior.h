@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+* Interior detection shared by the CPU escape time kernels.
+* Mirrors data/mandelbrot_interior.glsl.
+*/
+
+//Squared distance below which an orbit point repeats the saved one
+constexpr float PERIOD_TOLERANCE = 1e-12f;
+constexpr double PERIOD_TOLERANCE_DEEP = 1e-20;
+
+//c inside the main cardioid or the period 2 bulb never escapes
+inline bool inMainBulbs(glm::vec2 c) {
+	float c2 = glm::dot(c, c);
+	if (256.0f * c2 * c2 - 96.0f * c2 + 32.0f * c.x - 3.0f < 0.0f)
+		return true;
+	return 16.0f * (c2 + 2.0f * c.x + 1.0f) - 1.0f < 0.0f;
+}
+
+//Brent periodicity check: z is compared against an orbit point saved at
+//power of two intervals, an orbit that repeats is caught in a cycle and never escapes
+template<typename V>
+struct period_check {
+	V saved = V(0);
+	int counter = 0;
+	int interval = 1;
+
+	//steps > 1 when iterations were skipped
+	bool repeats(const V& z, typename V::value_type tolerance, int steps = 1) {
+		V d = z - saved;
+		if (glm::dot(d, d) < tolerance)
+			return true;
+
+		counter += steps;
+		if (counter >= interval) {
+			saved = z;
+			counter = 0;
+			interval *= 2;
+		}
+		return false;
+	}
+};
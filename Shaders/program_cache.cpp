@@ -0,0 +1,143 @@
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "program_cache.h"
+
+static constexpr uint32_t CACHE_MAGIC = 0x50524742; //"PRGB"
+
+std::string program_cache::_dir;
+std::string program_cache::_driver;
+bool program_cache::_enabled = false;
+int program_cache::_hits = 0;
+int program_cache::_misses = 0;
+
+//64-bit FNV-1a
+static uint64_t hash(const std::string& text, uint64_t h = 0xcbf29ce484222325ull) {
+	for (unsigned char c : text) {
+		h ^= c;
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+void program_cache::init(const char* dir) {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		std::cout << "Program binary cache disabled: driver exposes no binary formats\n";
+		return;
+	}
+
+	std::error_code err;
+	std::filesystem::create_directories(dir, err);
+	if (err) {
+		std::cout << "Program binary cache disabled: " << err.message() << "\n";
+		return;
+	}
+
+	std::stringstream driver;
+	driver << glGetString(GL_VENDOR) << "\n" << glGetString(GL_RENDERER) << "\n" << glGetString(GL_VERSION) << "\n";
+	_driver = driver.str();
+	_dir = dir;
+	_enabled = true;
+}
+
+unsigned long long program_cache::make_key(const std::string& source) {
+	return hash(source, hash(_driver));
+}
+
+std::string program_cache::entry_path(unsigned long long key) {
+	std::stringstream name;
+	name << std::hex << key << ".bin";
+	return (std::filesystem::path(_dir) / name.str()).string();
+}
+
+bool program_cache::load(GLuint program, unsigned long long key) {
+	if (!_enabled)
+		return false;
+
+	std::ifstream file(entry_path(key), std::ios::binary);
+
+	uint32_t magic = 0;
+	uint64_t storedKey = 0;
+	GLenum format = 0;
+	uint32_t length = 0;
+	if (file.is_open()) {
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&storedKey, sizeof(storedKey));
+		file.read((char*)&format, sizeof(format));
+		file.read((char*)&length, sizeof(length));
+	}
+
+	if (!file || magic != CACHE_MAGIC || storedKey != key || length == 0) {
+		_misses++;
+		return false;
+	}
+
+	std::vector<char> binary(length);
+	file.read(binary.data(), length);
+	if (!file) {
+		_misses++;
+		return false;
+	}
+
+	glProgramBinary(program, format, binary.data(), (GLsizei)length);
+
+	//Drivers reject binaries from other builds, fall back to compiling from source
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		_misses++;
+		return false;
+	}
+
+	_hits++;
+	return true;
+}
+
+void program_cache::store(GLuint program, unsigned long long key) {
+	if (!_enabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+	std::ofstream file(entry_path(key), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return;
+
+	uint32_t magic = CACHE_MAGIC;
+	uint64_t storedKey = key;
+	uint32_t size = (uint32_t)length;
+	file.write((const char*)&magic, sizeof(magic));
+	file.write((const char*)&storedKey, sizeof(storedKey));
+	file.write((const char*)&format, sizeof(format));
+	file.write((const char*)&size, sizeof(size));
+	file.write(binary.data(), length);
+}
+
+bool program_cache::isEnabled() {
+	return _enabled;
+}
+
+int program_cache::getHits() {
+	return _hits;
+}
+
+int program_cache::getMisses() {
+	return _misses;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+
+/*
+* On-disk cache of linked program binaries.
+* Entries are keyed by a hash of the program's sources and the driver's
+* vendor, renderer and version strings, so a driver update or an edited
+* shader simply misses and is rebuilt from source.
+*/
+class program_cache {
+
+	static std::string _dir;
+	static std::string _driver;
+	static bool _enabled;
+
+	static int _hits;
+	static int _misses;
+
+	static std::string entry_path(unsigned long long key);
+
+public:
+
+	program_cache() = delete;
+
+	//Must be called with a current context, creates the cache directory if needed
+	static void init(const char* dir);
+
+	static unsigned long long make_key(const std::string& source);
+
+	//Load a cached binary into program, false if there is none or the driver rejected it
+	static bool load(GLuint program, unsigned long long key);
+
+	//Save the binary of a linked program, the program must have been linked with
+	//GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static void store(GLuint program, unsigned long long key);
+
+	static bool isEnabled();
+
+	static int getHits();
+
+	static int getMisses();
+
+};
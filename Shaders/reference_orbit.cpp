@@ -0,0 +1,60 @@
+#include <cstring>
+
+#include "reference_orbit.h"
+
+bool reference_orbit::compute(const big_fixed& cx, const big_fixed& cy, int maxIterations) {
+	bool samePoint = !_orbit.empty() && cx == _cx && cy == _cy;
+	if (!samePoint) {
+		_cx = cx;
+		_cy = cy;
+		_zx = big_fixed();
+		_zy = big_fixed();
+		_escaped = false;
+
+		_orbit.clear();
+		_orbit.push_back(glm::dvec2(0.0));
+	}
+
+	//A higher cap continues from where the last one stopped, a lower one only uses a prefix
+	_orbit.reserve((size_t)maxIterations + 1);
+	while (!_escaped && (int)_orbit.size() <= maxIterations) {
+		big_fixed xy = _zx * _zy;
+		_zx = _zx * _zx - _zy * _zy + cx;
+		_zy = xy + xy + cy;
+
+		glm::dvec2 z(_zx.toDouble(), _zy.toDouble());
+		_orbit.push_back(z);
+
+		_escaped = glm::dot(z, z) > BAILOUT;
+	}
+
+	int length = std::min((int)_orbit.size(), maxIterations + 1);
+	bool changed = !samePoint || length != _length;
+	_length = length;
+	return changed;
+}
+
+void reference_orbit::clear() {
+	_orbit.clear();
+	_length = 0;
+}
+
+void reference_orbit::upload(ring_buffer& frame, double pixelScale) const {
+	GLsizeiptr orbitSize = (GLsizeiptr)(_length * sizeof(glm::dvec2));
+	ring_buffer::allocation alloc = frame.allocate_storage(sizeof(header) + orbitSize);
+
+	header h = { (GLint)_length, 0, pixelScale };
+	std::memcpy(alloc.ptr, &h, sizeof(header));
+	if (orbitSize > 0)
+		std::memcpy((unsigned char*)alloc.ptr + sizeof(header), _orbit.data(), orbitSize);
+
+	ring_buffer::bind(GL_SHADER_STORAGE_BUFFER, REFERENCE_ORBIT_BINDING, alloc);
+}
+
+int reference_orbit::getLength() const {
+	return _length;
+}
+
+const glm::dvec2* reference_orbit::getOrbit() const {
+	return _orbit.data();
+}
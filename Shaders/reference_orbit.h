@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "big_fixed.h"
+#include "ring_buffer.h"
+
+//Shader storage binding point of the ReferenceOrbit block in data/reference_orbit.glsl
+constexpr unsigned int REFERENCE_ORBIT_BINDING = 1;
+
+/*
+* Orbit of one point iterated at big_fixed precision.
+* Pixels around it only iterate their double difference to this orbit
+* (perturbation), so their precision no longer depends on the zoom.
+*/
+class reference_orbit {
+
+	//std430 header of the ReferenceOrbit block, the orbit follows at offset 16
+	struct header {
+		GLint length;
+		GLint _pad;
+		GLdouble pixelScale;
+	};
+
+	static_assert(sizeof(header) == 16, "header must match the std430 ReferenceOrbit block");
+
+	//Every point computed for this reference so far, the first _length are in use
+	std::vector<glm::dvec2> _orbit;
+	int _length = 0;
+
+	big_fixed _cx;
+	big_fixed _cy;
+
+	//Last point computed, where a higher iteration cap continues from
+	big_fixed _zx;
+	big_fixed _zy;
+	bool _escaped = false;
+
+public:
+
+	static constexpr double BAILOUT = 256.0 * 256.0;
+
+	//Iterate z = z^2 + c from z = 0 until z escapes or maxIterations is reached,
+	//false if the orbit in use did not change. Points already computed are reused.
+	bool compute(const big_fixed& cx, const big_fixed& cy, int maxIterations);
+
+	//Drop the orbit, upload then tells the shader to use plain float coordinates
+	void clear();
+
+	//Write the orbit into the frame's ring and bind it to REFERENCE_ORBIT_BINDING,
+	//pixelScale maps 2 * gl_FragCoord.xy - resolution to the offset from the reference
+	void upload(ring_buffer& frame, double pixelScale) const;
+
+	int getLength() const;
+
+	//getLength() points, Z_0 first
+	const glm::dvec2* getOrbit() const;
+
+};
@@ -0,0 +1,143 @@
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "ring_buffer.h"
+
+static constexpr GLbitfield RING_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+ring_buffer::ring_buffer(GLsizeiptr sectionSize) {
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_uniformAlign);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &_storageAlign);
+	create(sectionSize);
+}
+
+ring_buffer::~ring_buffer() {
+	for (GLsync& fence : _fences)
+		if (fence)
+			glDeleteSync(fence);
+
+	for (retired_buffer& r : _retired) {
+		if (r.fence)
+			glDeleteSync(r.fence);
+		glDeleteBuffers(1, &r.buffer);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &_buffer);
+}
+
+void ring_buffer::create(GLsizeiptr sectionSize) {
+	//Sections start on a boundary every offset alignment divides
+	_sectionSize = (sectionSize + 255) / 256 * 256;
+
+	glGenBuffers(1, &_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, _sectionSize * SECTIONS, NULL, RING_FLAGS);
+	_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, _sectionSize * SECTIONS, RING_FLAGS);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (!_mapped)
+		std::cout << "ERROR::RING_BUFFER:: Failed to map " << _sectionSize * SECTIONS << " bytes\n";
+}
+
+void ring_buffer::wait(GLsync fence) {
+	GLbitfield flags = 0;
+	GLuint64 timeout = 0;
+	for (;;) {
+		GLenum result = glClientWaitSync(fence, flags, timeout);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+			return;
+		//Flush once so the fence is guaranteed to signal, then block in 1ms slices
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		timeout = 1000000;
+	}
+}
+
+void ring_buffer::begin_frame() {
+	_section = (_section + 1) % SECTIONS;
+	_head = 0;
+
+	if (_fences[_section]) {
+		wait(_fences[_section]);
+		glDeleteSync(_fences[_section]);
+		_fences[_section] = 0;
+	}
+
+	//Buffers replaced by a grow are released once the frames using them finished
+	_retired.erase(std::remove_if(_retired.begin(), _retired.end(), [](retired_buffer& r) {
+		if (!r.fence || glClientWaitSync(r.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			return false;
+		glDeleteSync(r.fence);
+		glDeleteBuffers(1, &r.buffer);
+		return true;
+	}), _retired.end());
+}
+
+void ring_buffer::end_frame() {
+	_fences[_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	for (retired_buffer& r : _retired)
+		if (!r.fence)
+			r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+ring_buffer::allocation ring_buffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	GLintptr offset = (_head + alignment - 1) / alignment * alignment;
+
+	if (offset + size > _sectionSize) {
+		//Out of room: keep the old buffer alive until this frame's fence (which also covers every
+		//earlier frame) signals, and continue in a larger buffer the GPU has never read from
+		glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		_retired.push_back({ _buffer, 0 });
+
+		for (GLsync& fence : _fences) {
+			if (fence)
+				glDeleteSync(fence);
+			fence = 0;
+		}
+
+		create(std::max(_sectionSize * 2, (size + alignment) * 2));
+		_section = 0;
+		offset = 0;
+	}
+
+	allocation alloc;
+	alloc.ptr = _mapped + _section * _sectionSize + offset;
+	alloc.buffer = _buffer;
+	alloc.offset = _section * _sectionSize + offset;
+	alloc.size = size;
+
+	_head = offset + size;
+	return alloc;
+}
+
+ring_buffer::allocation ring_buffer::allocate_uniform(GLsizeiptr size) {
+	return allocate(size, _uniformAlign);
+}
+
+ring_buffer::allocation ring_buffer::allocate_storage(GLsizeiptr size) {
+	return allocate(size, _storageAlign);
+}
+
+ring_buffer::allocation ring_buffer::push(GLenum target, GLuint index, const void* data, GLsizeiptr size) {
+	allocation alloc = target == GL_UNIFORM_BUFFER ? allocate_uniform(size) : allocate_storage(size);
+	std::memcpy(alloc.ptr, data, size);
+	bind(target, index, alloc);
+	return alloc;
+}
+
+void ring_buffer::bind(GLenum target, GLuint index, const allocation& alloc) {
+	glBindBufferRange(target, index, alloc.buffer, alloc.offset, alloc.size);
+}
+
+GLsizeiptr ring_buffer::getSectionSize() const {
+	return _sectionSize;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+/*
+* Persistently mapped, triple buffered GPU buffer for per-frame data.
+* Each frame writes into its own section; a fence per section keeps the
+* CPU from overwriting data the GPU has not consumed yet.
+*/
+class ring_buffer {
+
+public:
+
+	static constexpr int SECTIONS = 3;
+
+	struct allocation {
+		void* ptr = nullptr;
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+	};
+
+private:
+
+	struct retired_buffer {
+		GLuint buffer;
+		GLsync fence;
+	};
+
+	GLuint _buffer = 0;
+	unsigned char* _mapped = nullptr;
+	GLsizeiptr _sectionSize;
+
+	GLsync _fences[SECTIONS] = {};
+	int _section = 0;
+	GLintptr _head = 0;
+
+	GLint _uniformAlign = 256;
+	GLint _storageAlign = 256;
+
+	std::vector<retired_buffer> _retired;
+
+	void create(GLsizeiptr sectionSize);
+
+	static void wait(GLsync fence);
+
+public:
+
+	ring_buffer() = delete;
+
+	explicit ring_buffer(GLsizeiptr sectionSize);
+
+	ring_buffer(const ring_buffer&) = delete;
+	ring_buffer& operator=(const ring_buffer&) = delete;
+
+	~ring_buffer();
+
+	//Wait until the GPU is done with the next section and start writing into it
+	void begin_frame();
+
+	//Fence the section written this frame
+	void end_frame();
+
+	allocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+
+	allocation allocate_uniform(GLsizeiptr size);
+
+	allocation allocate_storage(GLsizeiptr size);
+
+	//Copy data into the ring and bind it to an indexed buffer target (uniform or shader storage)
+	allocation push(GLenum target, GLuint index, const void* data, GLsizeiptr size);
+
+	static void bind(GLenum target, GLuint index, const allocation& alloc);
+
+	GLsizeiptr getSectionSize() const;
+
+};
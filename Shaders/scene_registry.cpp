@@ -0,0 +1,121 @@
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <utility>
+
+#include "scene_registry.h"
+
+double scene_registry::now() {
+	return std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void scene_registry::save_state(entry& e, const Camera& camera) {
+	e.camera = camera;
+	if (e.scene) {
+		const shader_inputs* in = e.scene->get_inputs();
+		e.inputs.zoom = in->zoom;
+		e.inputs.zoomRaw = in->zoomRaw;
+		e.inputs.centerX = in->centerX;
+		e.inputs.centerY = in->centerY;
+		e.inputs.samples = in->samples;
+	}
+}
+
+void scene_registry::add(const char* name, factory create, shader_inputs inputs, const Camera& camera) {
+	entry e;
+	e.name = name;
+	e.create = std::move(create);
+	e.inputs = inputs;
+	e.camera = camera;
+	_entries.push_back(std::move(e));
+}
+
+shader_object* scene_registry::select(int index, Camera& camera) {
+	if (index < 0 || index >= (int)_entries.size())
+		return current();
+
+	if (_current >= 0 && _current != index)
+		save_state(_entries[_current], camera);
+
+	entry& e = _entries[index];
+	if (!e.scene) {
+		e.scene = e.create(shader_inputs(e.inputs));
+		if (_resolution.x > 0 && _resolution.y > 0)
+			e.scene->framebuffer_resize(_resolution.x, _resolution.y);
+	}
+
+	if (_current != index)
+		camera = e.camera;
+
+	_current = index;
+	e.lastUsed = now();
+	return e.scene.get();
+}
+
+shader_object* scene_registry::current() {
+	if (_current < 0)
+		return nullptr;
+
+	entry& e = _entries[_current];
+	e.lastUsed = now();
+	return e.scene.get();
+}
+
+void scene_registry::resize(int width, int height) {
+	_resolution = glm::ivec2(width, height);
+
+	for (entry& e : _entries)
+		if (e.scene)
+			e.scene->framebuffer_resize(width, height);
+}
+
+void scene_registry::evict_idle(double maxIdle) {
+	double t = now();
+
+	for (int i = 0; i < (int)_entries.size(); i++) {
+		entry& e = _entries[i];
+		if (i == _current || !e.scene || t - e.lastUsed < maxIdle)
+			continue;
+
+		save_state(e, e.camera);
+		e.scene.reset();
+	}
+}
+
+int scene_registry::find(const char* name) const {
+	std::string lower(name);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	for (int i = 0; i < (int)_entries.size(); i++) {
+		std::string entryName = _entries[i].name;
+		std::transform(entryName.begin(), entryName.end(), entryName.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		if (entryName == lower)
+			return i;
+	}
+	return -1;
+}
+
+int scene_registry::getCurrentIndex() const {
+	return _current;
+}
+
+int scene_registry::size() const {
+	return (int)_entries.size();
+}
+
+const char* scene_registry::getName(int index) const {
+	return _entries[index].name.c_str();
+}
+
+bool scene_registry::isLoaded(int index) const {
+	return _entries[index].scene != nullptr;
+}
+
+const Camera& scene_registry::getCamera(int index) const {
+	return _entries[index].camera;
+}
+
+const shader_inputs& scene_registry::getInputs(int index) const {
+	return _entries[index].inputs;
+}
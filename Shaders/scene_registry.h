@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "shader_inputs.h"
+#include "shader_object.h"
+
+/*
+* Registry of scene factories.
+* Scenes are only built the first time they are selected, and scenes that
+* have not been shown for a while can be evicted to release their programs,
+* framebuffers and textures. Inputs and camera survive an eviction.
+*/
+class scene_registry {
+
+public:
+
+	using factory = std::function<std::unique_ptr<shader_object>(shader_inputs&&)>;
+
+private:
+
+	struct entry {
+		std::string name;
+		factory create;
+		shader_inputs inputs;
+		Camera camera;
+		std::unique_ptr<shader_object> scene;
+		double lastUsed = 0.0;
+	};
+
+	std::vector<entry> _entries;
+	int _current = -1;
+	glm::ivec2 _resolution = glm::ivec2(0);
+
+	static double now();
+
+	void save_state(entry& e, const Camera& camera);
+
+public:
+
+	void add(const char* name, factory create, shader_inputs inputs, const Camera& camera);
+
+	//Build the scene if needed and make it current, camera is swapped with the scene's own
+	shader_object* select(int index, Camera& camera);
+
+	shader_object* current();
+
+	//Resize loaded scenes now, scenes built later start at this size
+	void resize(int width, int height);
+
+	//Destroy scenes other than the current one that have not been shown for maxIdle seconds
+	void evict_idle(double maxIdle);
+
+	//Index of the scene with this name (case insensitive), -1 if there is none
+	int find(const char* name) const;
+
+	int getCurrentIndex() const;
+
+	int size() const;
+
+	const char* getName(int index) const;
+
+	bool isLoaded(int index) const;
+
+	//Camera and inputs the scene was registered with or last saved when it was deselected or evicted
+	const Camera& getCamera(int index) const;
+
+	const shader_inputs& getInputs(int index) const;
+
+};
@@ -1,6 +1,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
 
 #include "screen.h"
 #include "shader.h"
@@ -14,7 +18,28 @@ static GLfloat screen_coords[] = {
 	 1.0f,  1.0f, 0.0f,
 };
 
-screen::screen() : camera{} {
+//Room for the FrameGlobals block and typical per-frame scene parameters,
+//ring_buffer grows if a scene pushes more (reference orbits, palettes)
+static constexpr GLsizeiptr FRAME_DATA_SIZE = 64 * 1024;
+
+static void createTarget(GLuint& texture, GLuint& fb, glm::ivec2 size) {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glGenFramebuffers(1, &fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+screen::screen() : _frameData(FRAME_DATA_SIZE), _globals{}, _drawnGlobals{}, _upscaleShader("data/upscale.glsl"), camera{} {
 
 	glGenVertexArrays(1, &_vao);
 	glGenBuffers(1, &_vbo);
@@ -29,11 +54,18 @@ screen::screen() : camera{} {
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+
+	glGenQueries(2, _timerQueries);
 }
 
 screen::~screen() {
+	glDeleteFramebuffers(1, &_sceneFB);
+	glDeleteTextures(1, &_sceneTex);
+	glDeleteFramebuffers(1, &_shownFB);
+	glDeleteTextures(1, &_shownTex);
 	glDeleteBuffers(1, &_vbo);
 	glDeleteVertexArrays(1, &_vao);
+	glDeleteQueries(2, _timerQueries);
 }
 
 void screen::resetTime() {
@@ -56,47 +88,417 @@ void screen::setCursorPos(glm::vec2 curpos) {
 	_cursorPos = curpos;
 }
 
+ring_buffer& screen::getFrameData() {
+	return _frameData;
+}
+
+gpu_profiler& screen::getProfiler() {
+	return _profiler;
+}
+
+void screen::fill_globals(shader_object* obj, frame_globals& globals) const {
+	const shader_inputs* in = obj->get_inputs();
+
+	globals.cameraLoc = camera.loc;
+	globals.cameraLookAt = camera.lookAt;
+	globals.cameraUp = camera.up;
+	globals.cameraRight = camera.right;
+	globals.cameraFov = camera.fov;
+	globals.resolution = _resolution;
+	globals.cursorPos = _cursorPos;
+	globals.time = _time;
+	globals.elapsedTime = in->elapsedTime;
+	//Deep zooms pass their scale through their own buffers, the float block saturates
+	globals.zoom = (float)glm::min(in->zoom, (double)FLT_MAX);
+	globals.zoomRaw = in->zoomRaw;
+	globals.maxIterations = in->maxIterations;
+	globals.samples = in->samples;
+}
+
+void screen::update_globals(shader_object* obj, glm::ivec2 size, bool prepare) {
+	fill_globals(obj, _globals);
+	_globals.cursorPos *= glm::vec2(size) / _resolution;
+	_globals.resolution = glm::vec2(size);
+
+	//Scenes may update their inputs here (such as the iteration cap), before they are uploaded
+	if (prepare)
+		obj->prepare_frame(_globals);
+	_globals.maxIterations = obj->get_inputs()->maxIterations;
+
+	//Written straight into mapped memory once per frame, every program reads the block from FRAME_GLOBALS_BINDING
+	_frameData.push(GL_UNIFORM_BUFFER, FRAME_GLOBALS_BINDING, &_globals, sizeof(frame_globals));
+
+	obj->get_inputs()->upload(_frameData);
+}
+
+void screen::ensure_target() {
+	glm::ivec2 size(_resolution);
+	if (size == _sceneSize && _sceneFB)
+		return;
+
+	glDeleteFramebuffers(1, &_sceneFB);
+	glDeleteTextures(1, &_sceneTex);
+	glDeleteFramebuffers(1, &_shownFB);
+	glDeleteTextures(1, &_shownTex);
+
+	createTarget(_sceneTex, _sceneFB, size);
+	createTarget(_shownTex, _shownFB, size);
+
+	_sceneSize = size;
+	_dirty = true;
+	_presentShown = false;
+}
+
+void screen::present() const {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _presentShown ? _shownFB : _sceneFB);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, _sceneSize.x, _sceneSize.y, 0, 0, _sceneSize.x, _sceneSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void screen::invalidate() {
+	_dirty = true;
+}
+
+void screen::setProgressive(bool progressive) {
+	_progressive = progressive;
+	_dirty = true;
+}
+
+bool screen::isProgressive() const {
+	return _progressive;
+}
+
+void screen::setFrameBudget(double ms) {
+	_frameBudgetMs = glm::max(ms, 1.0);
+}
+
+double screen::getFrameBudget() const {
+	return _frameBudgetMs;
+}
+
+void screen::setDynamicResolution(bool dynamic) {
+	_dynamicResolution = dynamic;
+	_renderScale = 1.0f;
+	_dirty = true;
+}
+
+bool screen::isDynamicResolution() const {
+	return _dynamicResolution;
+}
+
+void screen::setTargetFrameTime(double ms) {
+	_targetFrameMs = glm::max(ms, 1.0);
+}
+
+double screen::getTargetFrameTime() const {
+	return _targetFrameMs;
+}
+
+float screen::getRenderScale() const {
+	return _renderScale;
+}
+
+bool screen::is_current(shader_object* obj) const {
+	//A reduced image of a moving view is followed by a full one once it holds still
+	if (_progress.active || _drawnScale < 1.0f || obj->reads_time() || obj->is_updating() || !obj->is_ready())
+		return false;
+
+	return same_view(obj);
+}
+
+bool screen::same_view(shader_object* obj) const {
+	if (_dirty || obj != _drawnObj || obj->get_inputs()->dirty)
+		return false;
+
+	if (glm::ivec2(_resolution) != _sceneSize)
+		return false;
+
+	frame_globals now;
+	fill_globals(obj, now);
+
+	//time and elapsedTime always change, they only matter to scenes that read them (handled above)
+	bool same = now.cameraLoc == _drawnGlobals.cameraLoc && now.cameraLookAt == _drawnGlobals.cameraLookAt &&
+		now.cameraUp == _drawnGlobals.cameraUp && now.cameraRight == _drawnGlobals.cameraRight &&
+		now.cameraFov == _drawnGlobals.cameraFov && now.resolution == _drawnGlobals.resolution &&
+		now.zoom == _drawnGlobals.zoom && now.zoomRaw == _drawnGlobals.zoomRaw &&
+		now.maxIterations == _drawnGlobals.maxIterations && now.samples == _drawnGlobals.samples;
+
+	if (obj->reads_cursor())
+		same = same && now.cursorPos == _drawnGlobals.cursorPos;
+
+	return same;
+}
+
+void screen::read_pixels(std::vector<unsigned char>& rgb) const {
+	rgb.resize((size_t)_sceneSize.x * _sceneSize.y * 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _presentShown ? _shownFB : _sceneFB);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, _sceneSize.x, _sceneSize.y, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 void screen::draw_screen(shader_object* obj) {
+	if (render(obj))
+		present();
+}
+
+bool screen::render(shader_object* obj) {
+	//Nothing to draw until every program of the scene has linked
+	if (!obj->is_ready())
+		return false;
+
 	_time += obj->get_inputs()->elapsedTime;
 
+	ensure_target();
+
+	if (is_current(obj))
+		return true;
+
+	if (_progressive && obj->is_progressive())
+		return render_progressive(obj);
+
+	_progress = progress();
+
+	//Views in motion are drawn at the dynamic scale and upscaled, the first still frame at full size
+	bool scaled = _dynamicResolution && obj->is_progressive() && _upscaleShader.poll() && !same_view(obj);
+	float scale = scaled ? _renderScale : 1.0f;
+	glm::ivec2 size = glm::max(glm::ivec2(glm::vec2(_sceneSize) * scale + 0.5f), glm::ivec2(1));
+
+	if (_dynamicResolution)
+		read_timer();
+
+	_frameData.begin_frame();
+
+	update_globals(obj, size);
+	obj->bind_textures();
+
+	int timer = _timerFrame & 1;
+	if (_dynamicResolution) {
+		glBeginQuery(GL_TIME_ELAPSED, _timerQueries[timer]);
+		_timerScales[timer] = scale;
+	}
+
+	glBindVertexArray(_vao);
+	glViewport(0, 0, size.x, size.y);
+
 	if (obj->has_input_shaders()) {
 		int last = obj->input_shaders_count();
 		for (int i = 0; i < last; i++) {
+			_profiler.begin(obj->pass_name(i));
+
 			GLuint prog = obj->setup_input_shader(i);
 
 			obj->get_inputs()->send_data(prog);
 
-			glUniform2fv(glGetUniformLocation(prog, "resolution"), 1, glm::value_ptr(_resolution));
-			glUniform2fv(glGetUniformLocation(prog, "cursorPos"), 1, glm::value_ptr(_cursorPos));
-			glUniform3fv(glGetUniformLocation(prog, "camera.loc"), 1, glm::value_ptr(camera.loc));
-			glUniform3fv(glGetUniformLocation(prog, "camera.lookAt"), 1, glm::value_ptr(camera.lookAt));
-			glUniform3fv(glGetUniformLocation(prog, "camera.up"), 1, glm::value_ptr(camera.up));
-			glUniform3fv(glGetUniformLocation(prog, "camera.right"), 1, glm::value_ptr(camera.right));
-			glUniform1f(glGetUniformLocation(prog, "camera.fov"), camera.fov);
-			glUniform1f(glGetUniformLocation(prog, "time"), _time);
-
-			glBindVertexArray(_vao);
-
 			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+			_profiler.end();
 		}
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	_profiler.begin(obj->pass_name(obj->has_input_shaders() ? obj->input_shaders_count() : 0));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _sceneFB);
 
 	GLuint prog = obj->use_main_program();
 
 	obj->get_inputs()->send_data(prog);
 
-	glUniform2fv(glGetUniformLocation(prog, "resolution"), 1, glm::value_ptr(_resolution));
-	glUniform2fv(glGetUniformLocation(prog, "cursorPos"), 1, glm::value_ptr(_cursorPos));
-	glUniform3fv(glGetUniformLocation(prog, "camera.loc"), 1, glm::value_ptr(camera.loc));
-	glUniform3fv(glGetUniformLocation(prog, "camera.lookAt"), 1, glm::value_ptr(camera.lookAt));
-	glUniform3fv(glGetUniformLocation(prog, "camera.up"), 1, glm::value_ptr(camera.up));
-	glUniform3fv(glGetUniformLocation(prog, "camera.right"), 1, glm::value_ptr(camera.right));
-	glUniform1f(glGetUniformLocation(prog, "camera.fov"), camera.fov);
-	glUniform1f(glGetUniformLocation(prog, "time"), _time);
+	if (obj->main_is_compute())
+		obj->dispatch_main(glm::ivec4(0, 0, size), _sceneTex);
+	else
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	glBindVertexArray(_vao);
+	_profiler.end();
 
+	if (_dynamicResolution) {
+		glEndQuery(GL_TIME_ELAPSED);
+		_timerPending[timer] = true;
+		_timerFrame++;
+	}
+
+	_presentShown = size != _sceneSize;
+	if (_presentShown) {
+		_profiler.begin("Upscale");
+		upscale(obj, size);
+		_profiler.end();
+	}
+
+	glViewport(0, 0, _sceneSize.x, _sceneSize.y);
+
+	_frameData.end_frame();
+
+	_drawnGlobals = _globals;
+	_drawnGlobals.resolution = _resolution;
+	_drawnGlobals.cursorPos = _cursorPos;
+	_drawnScale = scale;
+	_drawnObj = obj;
+	_dirty = false;
+	obj->get_inputs()->dirty = false;
+
+	return true;
+}
+
+void screen::upscale(shader_object* obj, glm::ivec2 size) {
+	upscale_params params = {};
+	params.sourceSize = size;
+	params.targetSize = _sceneSize;
+
+	GLuint guide = obj->upscale_guide(params.guideWeights);
+	params.hasGuide = guide != 0;
+
+	_frameData.push(GL_UNIFORM_BUFFER, UPSCALE_BINDING, &params, sizeof(upscale_params));
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _sceneTex);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, guide);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _shownFB);
+	glViewport(0, 0, _sceneSize.x, _sceneSize.y);
+	_upscaleShader.use();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void screen::read_timer() {
+	int timer = _timerFrame & 1;
+	if (!_timerPending[timer])
+		return;
+
+	//Still running, the query is reused anyway and this measurement is dropped
+	_timerPending[timer] = false;
+	GLint available = 0;
+	glGetQueryObjectiv(_timerQueries[timer], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint64 ns = 0;
+	glGetQueryObjectui64v(_timerQueries[timer], GL_QUERY_RESULT, &ns);
+	tune_render_scale(ns * 1e-6, _timerScales[timer]);
+}
+
+void screen::tune_render_scale(double ms, float drawnScale) {
+	//Cost follows the pixel count, the square of the scale. Half steps toward it keep the scale from oscillating.
+	double ideal = drawnScale * std::sqrt(_targetFrameMs / glm::max(ms, 0.01));
+	double next = glm::mix((double)_renderScale, ideal, 0.5);
+	next = std::round(next / RENDER_SCALE_STEP) * RENDER_SCALE_STEP;
+	_renderScale = (float)glm::clamp(next, MIN_RENDER_SCALE, 1.0);
+}
+
+bool screen::render_progressive(shader_object* obj) {
+	//A new view starts over at the coarsest level, a scene still updating the same view only redraws the finest
+	bool viewChanged = !same_view(obj);
+	if (viewChanged || !_progress.active) {
+		//Tiles land in the scene image, keep showing the last finished one until a level is done
+		if (!_presentShown) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, _sceneFB);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _shownFB);
+			glBlitFramebuffer(0, 0, _sceneSize.x, _sceneSize.y, 0, 0, _sceneSize.x, _sceneSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			_presentShown = true;
+		}
+
+		_progress = progress();
+		_progress.active = true;
+		_progress.level = viewChanged ? 0 : PROGRESSIVE_LEVELS - 1;
+	}
+
+	int stride = PROGRESSIVE_STRIDES[_progress.level];
+	glm::ivec2 size = glm::max(_sceneSize / stride, glm::ivec2(1));
+
+	_frameData.begin_frame();
+
+	//Scenes prepare once per level, the tiles of later frames draw with the same state
+	update_globals(obj, size, !_progress.prepared);
+	obj->bind_textures();
+
+	if (!_progress.prepared) {
+		_progress.prepared = true;
+
+		_drawnGlobals = _globals;
+		_drawnGlobals.resolution = _resolution;
+		_drawnGlobals.cursorPos = _cursorPos;
+		_drawnScale = 1.0f;
+		_drawnObj = obj;
+		_dirty = false;
+		obj->get_inputs()->dirty = false;
+	}
+
+	glBindVertexArray(_vao);
+	glViewport(0, 0, size.x, size.y);
+	glEnable(GL_SCISSOR_TEST);
+
+	int passes = obj->has_input_shaders() ? obj->input_shaders_count() : 0;
+	glm::ivec2 tiles = (size + PROGRESSIVE_TILE_SIZE - 1) / PROGRESSIVE_TILE_SIZE;
+	int tileCount = tiles.x * tiles.y;
+	int budget = glm::max((int)(_frameBudgetMs / _tileMs), 1);
+
+	auto start = std::chrono::steady_clock::now();
+
+	int drawn = 0;
+	while (drawn < budget) {
+		//The main pass is the last one, passes read their neighbors across tile edges so each covers every tile first
+		_profiler.begin(obj->pass_name(_progress.pass));
+
+		GLuint prog;
+		bool compute = false;
+		if (_progress.pass < passes) {
+			prog = obj->setup_input_shader(_progress.pass);
+		} else {
+			glBindFramebuffer(GL_FRAMEBUFFER, _sceneFB);
+			prog = obj->use_main_program();
+			compute = obj->main_is_compute();
+		}
+		obj->get_inputs()->send_data(prog);
+
+		for (; drawn < budget && _progress.tile < tileCount; drawn++, _progress.tile++) {
+			glm::ivec2 t(_progress.tile % tiles.x, _progress.tile / tiles.x);
+			glm::ivec2 lo = t * PROGRESSIVE_TILE_SIZE;
+			if (compute) {
+				//Dispatches ignore the scissor, the tile is passed as the rect instead
+				obj->dispatch_main(glm::ivec4(lo, glm::min(lo + PROGRESSIVE_TILE_SIZE, size)), _sceneTex);
+			} else {
+				glScissor(lo.x, lo.y, PROGRESSIVE_TILE_SIZE, PROGRESSIVE_TILE_SIZE);
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			}
+		}
+
+		_profiler.end();
+
+		if (_progress.tile < tileCount)
+			break;
+
+		_progress.tile = 0;
+		if (++_progress.pass <= passes)
+			continue;
+
+		//Level finished, show it scaled up until the next one is
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _sceneFB);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _shownFB);
+		glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, _sceneSize.x, _sceneSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		_presentShown = true;
+
+		_progress.pass = 0;
+		_progress.prepared = false;
+		_progress.active = ++_progress.level < PROGRESSIVE_LEVELS;
+		break;
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glViewport(0, 0, _sceneSize.x, _sceneSize.y);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	//Waiting here keeps each frame within the budget, the tiles are small enough to never trip a driver watchdog
+	glFinish();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (drawn > 0)
+		_tileMs = glm::max(0.5 * (_tileMs + ms / drawn), 0.01);
+
+	_frameData.end_frame();
+
+	return true;
 }
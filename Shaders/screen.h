@@ -3,18 +3,128 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <vector>
+
 #include "camera.h"
+#include "frame_globals.h"
+#include "gpu_profiler.h"
+#include "ring_buffer.h"
+#include "shader.h"
+
+//Uniform buffer binding point of the Upscale block in data/upscale.glsl
+constexpr unsigned int UPSCALE_BINDING = 3;
 
 class screen {
 
+public:
+
+	//Progressive levels draw one pixel per stride x stride block, coarsest first
+	static constexpr int PROGRESSIVE_LEVELS = 3;
+	static constexpr int PROGRESSIVE_STRIDES[PROGRESSIVE_LEVELS] = { 4, 2, 1 };
+
+	//Edge of the scissored tiles progressive passes are split into, in pixels of the level
+	static constexpr int PROGRESSIVE_TILE_SIZE = 128;
+
+	static constexpr double DEFAULT_FRAME_BUDGET_MS = 8.0;
+
+	//Dynamic resolution scales moving views between these, in steps so scenes do not reallocate every frame
+	static constexpr double MIN_RENDER_SCALE = 0.25;
+	static constexpr double RENDER_SCALE_STEP = 1.0 / 16.0;
+	static constexpr double DEFAULT_TARGET_FRAME_MS = 12.0;
+
+private:
+
+	//CPU mirror of the std140 Upscale block
+	struct upscale_params {
+		glm::vec4 guideWeights;
+		glm::ivec2 sourceSize;
+		glm::ivec2 targetSize;
+		int hasGuide;
+		int _pad[3];
+	};
+
+	static_assert(sizeof(upscale_params) == 48, "upscale_params must match the std140 Upscale block");
+
+	//Position of a progressive render, every pass is drawn over all tiles before the next one starts
+	struct progress {
+		bool active = false;
+		bool prepared = false;
+		int level = 0;
+		int pass = 0;
+		int tile = 0;
+	};
+
 	GLuint _vao;
 	GLuint _vbo;
 
+	ring_buffer _frameData;
+
+	frame_globals _globals;
+
+	//Cached final image, re-presented while nothing it depends on changes
+	GLuint _sceneFB = 0;
+	GLuint _sceneTex = 0;
+	glm::ivec2 _sceneSize = glm::ivec2(0);
+
+	//State the cached image was rendered with
+	frame_globals _drawnGlobals;
+	const class shader_object* _drawnObj = nullptr;
+	bool _dirty = true;
+
+	bool _progressive = false;
+	double _frameBudgetMs = DEFAULT_FRAME_BUDGET_MS;
+	progress _progress;
+
+	//Running estimate of the GPU time of one tile, sets how many fit the frame budget
+	double _tileMs = 1.0;
+
+	//Last finished progressive level scaled to the window, presented while the next one is drawn
+	GLuint _shownFB = 0;
+	GLuint _shownTex = 0;
+	bool _presentShown = false;
+
+	//Dynamic resolution, the scale of the next moving frame is tuned from GPU timers of earlier ones
+	bool _dynamicResolution = false;
+	double _targetFrameMs = DEFAULT_TARGET_FRAME_MS;
+	float _renderScale = 1.0f;
+	float _drawnScale = 1.0f;
+
+	//Double buffered so a result is only read once the GPU is done with it
+	GLuint _timerQueries[2] = {};
+	float _timerScales[2] = {};
+	bool _timerPending[2] = {};
+	int _timerFrame = 0;
+
+	shader _upscaleShader;
+
+	gpu_profiler _profiler;
+
 	float _time = 0.0f;
 
 	glm::vec2 _resolution;
 	glm::vec2 _cursorPos;
 
+	void fill_globals(class shader_object* obj, frame_globals& globals) const;
+
+	//Scenes drawn smaller than the window see size as the resolution, prepare_frame is skipped when prepare is false
+	void update_globals(class shader_object* obj, glm::ivec2 size, bool prepare = true);
+
+	void ensure_target();
+
+	//True when camera, inputs and scene still match the last image started
+	bool same_view(class shader_object* obj) const;
+
+	//Draws as many tiles of the current progressive level as fit the frame budget
+	bool render_progressive(class shader_object* obj);
+
+	//Scales the size x size corner of the scene image up into the shown image, edge aware where the scene has a guide
+	void upscale(class shader_object* obj, glm::ivec2 size);
+
+	//Reads the oldest timer if it is done and moves the render scale toward the target frame time
+	void read_timer();
+
+	void tune_render_scale(double ms, float drawnScale);
+
 public:
 
 	Camera camera;
@@ -30,8 +140,49 @@ public:
 
 	glm::vec2 getCursorPos() const;
 
+	ring_buffer& getFrameData();
+
+	//Times every pass the screen draws, the application adds its own sections (ImGui)
+	gpu_profiler& getProfiler();
+
 	void setCursorPos(glm::vec2 curpos);
 
+	//Force the next draw_screen to re-render
+	void invalidate();
+
+	//Progressive scenes are then drawn coarse to fine in tiles, spread over frames so input stays responsive
+	void setProgressive(bool progressive);
+
+	bool isProgressive() const;
+
+	void setFrameBudget(double ms);
+
+	double getFrameBudget() const;
+
+	//Progressive scenes in motion are then drawn at a tuned fraction of the window and upscaled, still views at full size
+	void setDynamicResolution(bool dynamic);
+
+	bool isDynamicResolution() const;
+
+	void setTargetFrameTime(double ms);
+
+	double getTargetFrameTime() const;
+
+	float getRenderScale() const;
+
+	//True when the cached image still matches the camera, inputs and scene
+	bool is_current(class shader_object* obj) const;
+
+	//Renders the scene into the cached image if it changed, false while the scene is not ready
+	bool render(class shader_object* obj);
+
+	//Copy the cached image to the default framebuffer
+	void present() const;
+
+	//Read the cached image back as tightly packed RGB rows, bottom row first
+	void read_pixels(std::vector<unsigned char>& rgb) const;
+
+	//render followed by present
 	void draw_screen(class shader_object* obj);
 };
 
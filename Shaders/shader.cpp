@@ -1,4 +1,6 @@
 #include <cassert>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -6,41 +8,112 @@
 
 #include <glad/glad.h>
 
+#include "program_cache.h"
 #include "shader.h"
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
 static const char* vpath = "data/vert.glsl";
 static std::string vtext;
 static GLuint vShader = 0;
 
+bool shader::_parallelCompile = false;
+
 bool checkCompileErrors(GLuint shader, std::string type, std::string file);
 
-shader::shader(const char *frag_path) {
+//Read a shader file, expanding #include "file" lines relative to the including file
+static bool loadSource(const std::filesystem::path& path, std::string& out, int depth = 0) {
+	std::ifstream file(path);
+	if (!file.is_open() || depth > 8) {
+		std::cout << "Shader file " << path.string() << " failed to open\n";
+		return false;
+	}
+
+	std::stringstream stream;
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t first = line.find_first_not_of(" \t");
+		if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+			size_t open = line.find('"', first);
+			size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+			if (close == std::string::npos) {
+				std::cout << "Malformed #include in " << path.string() << "\n";
+				return false;
+			}
+
+			std::string included;
+			if (!loadSource(path.parent_path() / line.substr(open + 1, close - open - 1), included, depth + 1))
+				return false;
+			stream << included << "\n";
+		} else {
+			stream << line << "\n";
+		}
+	}
+
+	out = stream.str();
+	return true;
+}
+
+shader::shader(const char *frag_path, GLenum stage) {
 	_fpath = frag_path;
+	_stage = stage;
 
-	std::ifstream fShaderFile;
-	std::stringstream fShaderStream;
+	if (!loadSource(_fpath, _ftext)) {
+		std::cout << (is_compute() ? "Compute" : "Fragment") << " Shader File failed to open\n";
+		return;
+	}
 
-	fShaderFile.open(_fpath);
-	if (!fShaderFile.is_open()) {
-		std::cout << "Fragment Shader File failed to open\n";
+	_program = glCreateProgram();
+	_status = status::PENDING;
+
+	_cacheKey = program_cache::make_key(is_compute() ? _ftext : vtext + _ftext);
+	if (program_cache::load(_program, _cacheKey)) {
+		_status = status::READY;
 		return;
 	}
 
-	fShaderStream << fShaderFile.rdbuf();
-	fShaderFile.close();
-	_ftext = fShaderStream.str();
 	const char* cftext = _ftext.c_str();
 
-	_fShader = glCreateShader(GL_FRAGMENT_SHADER);
+	//Errors are only checked once the link has completed, see poll()
+	_fShader = glCreateShader(_stage);
 	glShaderSource(_fShader, 1, &cftext, NULL);
 	glCompileShader(_fShader);
-	checkCompileErrors(_fShader, "FRAGMENT", _fpath);
 
-	_program = glCreateProgram();
-	glAttachShader(_program, vShader);
+	glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	if (!is_compute())
+		glAttachShader(_program, vShader);
 	glAttachShader(_program, _fShader);
 	glLinkProgram(_program);
-	checkCompileErrors(_program, "PROGRAM", _fpath);
+}
+
+void shader::finish_link() {
+	if (!checkCompileErrors(_program, "PROGRAM", _fpath)) {
+		checkCompileErrors(_fShader, is_compute() ? "COMPUTE" : "FRAGMENT", _fpath);
+		_status = status::FAILED;
+		return;
+	}
+
+	program_cache::store(_program, _cacheKey);
+	_status = status::READY;
+}
+
+bool shader::poll() {
+	if (_status != status::PENDING)
+		return _status == status::READY;
+
+	if (_parallelCompile) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(_program, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done)
+			return false;
+	}
+
+	finish_link();
+	return _status == status::READY;
 }
 
 bool shader::init_vert() {
@@ -65,13 +138,42 @@ bool shader::init_vert() {
 	return checkCompileErrors(vShader, "VERTEX", "data/vert.glsl");
 }
 
+void shader::init_parallel_compile(GLADloadproc load) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+	bool found = false;
+	const char* name = nullptr;
+	for (GLint i = 0; i < count && !found; i++) {
+		const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (std::strcmp(ext, "GL_KHR_parallel_shader_compile") == 0) {
+			name = "glMaxShaderCompilerThreadsKHR";
+			found = true;
+		} else if (std::strcmp(ext, "GL_ARB_parallel_shader_compile") == 0) {
+			name = "glMaxShaderCompilerThreadsARB";
+			found = true;
+		}
+	}
+
+	if (!found)
+		return;
+
+	//Both extensions share the GL_COMPLETION_STATUS token
+	auto maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(name);
+	if (maxThreads)
+		maxThreads(0xFFFFFFFF); //let the driver pick the thread count
+
+	_parallelCompile = true;
+}
+
 void shader::destroy_vert() {
 	if (vShader)
 		glDeleteShader(vShader);
 }
 
 shader::~shader() {
-	glDeleteShader(_fShader);
+	if (_fShader)
+		glDeleteShader(_fShader);
 	glDeleteProgram(_program);
 }
 
@@ -79,6 +181,10 @@ GLuint shader::getProgram() const {
 	return _program;
 }
 
+bool shader::is_compute() const {
+	return _stage == GL_COMPUTE_SHADER;
+}
+
 void shader::use() const {
 	glUseProgram(_program);
 }
@@ -6,24 +6,49 @@
 
 class shader {
 
+	enum class status {
+		PENDING,
+		READY,
+		FAILED
+	};
+
 	const char* _fpath;
 	std::string _ftext;
+	GLenum _stage;
 	GLuint _fShader = 0;
 	GLuint _program = 0;
 
+	status _status = status::FAILED;
+	unsigned long long _cacheKey = 0;
+
+	static bool _parallelCompile;
+
+	void finish_link();
+
 public:
 
 	shader() = delete;
-	shader(const char* frag_path);
+
+	//Queues the compile and link, the program is usable once poll() returns true.
+	//Fragment shaders are linked with data/vert.glsl, compute shaders on their own.
+	shader(const char* frag_path, GLenum stage = GL_FRAGMENT_SHADER);
 
 	static bool init_vert();
 	static void destroy_vert();
 
+	//Let the driver compile on its own threads when GL_KHR_parallel_shader_compile is available
+	static void init_parallel_compile(GLADloadproc load);
+
 	virtual ~shader();
 
+	//Non-blocking with parallel compile, otherwise finishes the link on the first call
+	bool poll();
+
 	void use() const;
 
 	GLuint getProgram() const;
 
+	bool is_compute() const;
+
 };
 
@@ -3,18 +3,36 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "big_fixed.h"
+#include "ring_buffer.h"
+
 struct shader_inputs {
 	float elapsedTime = 0.0f;
-	float zoom = 1.0f;
+	double zoom = 1.0;
 	float zoomRaw = 0.0f;
 
+	//Iteration cap of escape time scenes, set by the scene in prepare_frame
+	int maxIterations = 0;
+
+	//Most samples per pixel of supersampling scenes, 0 for scenes that do not supersample
+	int samples = 0;
+
+	//View center of 2D scenes at full precision, camera.loc.xy only holds it rounded to float
+	big_fixed centerX;
+	big_fixed centerY;
+
+	//Set when a value the shaders read changed outside of the FrameGlobals block,
+	//screen re-renders and clears it
+	bool dirty = true;
+
 	shader_inputs() { }
 
-	shader_inputs(float dt, float z, float zr) : elapsedTime(dt), zoom(z), zoomRaw(zr) { }
+	shader_inputs(float dt, double z, float zr) : elapsedTime(dt), zoom(z), zoomRaw(zr) { }
+
+	//elapsedTime, zoom, zoomRaw, maxIterations and samples reach the shaders through the FrameGlobals block,
+	//derived inputs only need to send their own per-program uniforms here
+	virtual void send_data(GLuint program) const { }
 
-	virtual void send_data(GLuint program) const {
-		glUniform1f(glGetUniformLocation(program, "elapsedTime"), elapsedTime);
-		glUniform1f(glGetUniformLocation(program, "zoom"), zoom);
-		glUniform1f(glGetUniformLocation(program, "zoomRaw"), zoomRaw);
-	}
+	//Called once per frame; larger per-frame payloads are written into the ring and bound by range
+	virtual void upload(ring_buffer& frame) const { }
 };
\ No newline at end of file
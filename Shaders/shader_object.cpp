@@ -4,7 +4,7 @@
 #include "shader_object.h"
 #include "shader_inputs.h"
 
-shader_object::shader_object(const char *shader_file) : _mainShader(shader_file) { }
+shader_object::shader_object(const char *shader_file, GLenum stage) : _mainShader(shader_file, stage) { }
 
 void shader_object::mouse_button(int button, int action, int mods) {
 	//Behavior is implemented by derived class
@@ -26,7 +26,71 @@ GLuint shader_object::setup_input_shader(const int index) {
 	return 0;
 }
 
+const char* shader_object::pass_name(const int index) const {
+	return index < input_shaders_count() ? "Input pass" : "Main pass";
+}
+
+bool shader_object::reads_time() const {
+	return false;
+}
+
+bool shader_object::reads_cursor() const {
+	return false;
+}
+
+bool shader_object::is_updating() const {
+	return false;
+}
+
+bool shader_object::is_progressive() const {
+	return false;
+}
+
+GLuint shader_object::upscale_guide(glm::vec4& weights) const {
+	return 0;
+}
+
+void shader_object::prepare_frame(const frame_globals& globals) {
+	//Behavior is implemented by derived class
+}
+
+void shader_object::bind_textures() {
+	//Behavior is implemented by derived class
+}
+
+void shader_object::discard_cache() {
+	//Behavior is implemented by derived class
+}
+
+void shader_object::draw_imgui() {
+	//Behavior is implemented by derived class
+}
+
+bool shader_object::is_ready() {
+	return _mainShader.poll();
+}
+
 GLuint shader_object::use_main_program() {
 	_mainShader.use();
 	return _mainShader.getProgram();
 }
+
+bool shader_object::main_is_compute() const {
+	return _mainShader.is_compute();
+}
+
+void shader_object::dispatch_main(glm::ivec4 rect, GLuint target) {
+	glm::ivec2 size(rect.z - rect.x, rect.w - rect.y);
+	if (size.x <= 0 || size.y <= 0)
+		return;
+
+	//Location 0 is the tileRect uniform of data/tile_cache.glsl
+	glUniform4i(0, rect.x, rect.y, rect.z, rect.w);
+	glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+	glm::ivec2 groups = (size + COMPUTE_TILE - 1) / COMPUTE_TILE;
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	//The scene image is read next by the upscaler, blits and the presenting draw
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
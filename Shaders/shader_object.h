@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 
+#include "frame_globals.h"
 #include "shader.h"
 #include "shader_inputs.h"
 
@@ -11,10 +12,14 @@ class shader_object {
 
 protected:
 
-	explicit shader_object(const char* shader_file);
+	//The main pass is a compute shader when stage is GL_COMPUTE_SHADER, see dispatch_main
+	explicit shader_object(const char* shader_file, GLenum stage = GL_FRAGMENT_SHADER);
 
 public:
 
+	//Pixels per side of the work groups of compute main passes, must match data/tile_cache.glsl
+	static constexpr int COMPUTE_TILE = 16;
+
 	shader_object() = delete;
 
 	virtual ~shader_object() = default;
@@ -31,9 +36,51 @@ public:
 
 	virtual GLuint setup_input_shader(const int index) = 0;
 
+	//Name of a pass in the profiler, index input_shaders_count() is the main pass
+	virtual const char* pass_name(const int index) const;
+
 	virtual void framebuffer_resize(int width, int height) = 0;
 
 	virtual GLuint use_main_program() final;
 
+	bool main_is_compute() const;
+
+	//Runs the bound compute main pass over the pixels x0, y0, x1, y1 of rect, writing them to image unit 0.
+	//target must be GL_RGBA8, it is ready to be sampled and blitted from afterwards.
+	void dispatch_main(glm::ivec4 rect, GLuint target);
+
+	//Polls the scene's programs, the scene is only drawn once all of them linked
+	virtual bool is_ready();
+
+	//Scenes that animate with time or follow the cursor are redrawn every frame,
+	//all others only when the camera or inputs change
+	virtual bool reads_time() const;
+
+	virtual bool reads_cursor() const;
+
+	//Scenes producing their image in the background are redrawn until they finish
+	virtual bool is_updating() const;
+
+	//Scenes whose passes may be drawn in scissored tiles over several frames, at a
+	//reduced resolution into the lower left corner of their targets (progressive
+	//rendering and dynamic resolution)
+	virtual bool is_progressive() const;
+
+	//Texture the upscaler compares neighbors in, each is blended with a weight of
+	//exp(-dot(weights, difference^2)). 0 when the scene has none.
+	virtual GLuint upscale_guide(glm::vec4& weights) const;
+
+	//Called with this frame's globals before the inputs are uploaded and any pass is drawn
+	virtual void prepare_frame(const frame_globals& globals);
+
+	//Binds the textures the passes sample, every frame any pass is drawn, as ImGui rebinds units in between
+	virtual void bind_textures();
+
+	//Drop results kept between frames so the next one is rendered from scratch (benchmarks)
+	virtual void discard_cache();
+
+	//Scene specific controls, drawn inside the Shaders window
+	virtual void draw_imgui();
+
 };
 
@@ -0,0 +1,151 @@
+
+#include <algorithm>
+
+#include "tile_scheduler.h"
+
+tile_scheduler::tile_scheduler(int threads) : _generation(0), _queued(0), _outstanding(0) {
+	if (threads <= 0)
+		threads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 0; i < threads; i++)
+		_queues.push_back(std::make_unique<worker_queue>());
+
+	for (int i = 0; i < threads; i++)
+		_threads.emplace_back(&tile_scheduler::worker_main, this, i);
+}
+
+tile_scheduler::~tile_scheduler() {
+	cancel();
+
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_quit = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread& t : _threads)
+		t.join();
+}
+
+bool tile_scheduler::pop(int worker, tile& t) {
+	const int count = (int)_queues.size();
+
+	//Own queue first, then steal from the others; fronts hold the highest priority tiles
+	for (int i = 0; i < count; i++) {
+		worker_queue& q = *_queues[(worker + i) % count];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (!q.tiles.empty()) {
+			t = q.tiles.front();
+			q.tiles.pop_front();
+			_queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void tile_scheduler::finish_tiles(int count) {
+	if (count > 0 && (_outstanding -= count) == 0) {
+		std::lock_guard<std::mutex> guard(_lock);
+		_idle.notify_all();
+	}
+}
+
+void tile_scheduler::worker_main(int worker) {
+	for (;;) {
+		tile t;
+		if (pop(worker, t)) {
+			if (!is_cancelled(t))
+				_job(t);
+			finish_tiles(1);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(_lock);
+		_wake.wait(guard, [this]() { return _quit || _queued > 0; });
+		if (_quit)
+			return;
+	}
+}
+
+unsigned tile_scheduler::submit(int width, int height, int tileSize, glm::vec2 focus, job fn) {
+	cancel();
+
+	//No tile is queued or running here, so the job can be replaced safely
+	_job = std::move(fn);
+	unsigned generation = ++_generation;
+
+	std::vector<tile> tiles;
+	for (int y = 0; y < height; y += tileSize)
+		for (int x = 0; x < width; x += tileSize)
+			tiles.push_back({ x, y, std::min(x + tileSize, width), std::min(y + tileSize, height), generation });
+
+	auto distance = [&](const tile& t) {
+		glm::vec2 center(0.5f * (t.x0 + t.x1), 0.5f * (t.y0 + t.y1));
+		glm::vec2 d = center - focus;
+		return glm::dot(d, d);
+	};
+	std::stable_sort(tiles.begin(), tiles.end(), [&](const tile& a, const tile& b) { return distance(a) < distance(b); });
+
+	if (tiles.empty())
+		return generation;
+
+	_outstanding = (int)tiles.size();
+
+	//Deal round robin so every worker starts near the focus
+	const int count = (int)_queues.size();
+	for (int i = 0; i < (int)tiles.size(); i++) {
+		worker_queue& q = *_queues[i % count];
+		std::lock_guard<std::mutex> guard(q.lock);
+		q.tiles.push_back(tiles[i]);
+		_queued++;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+	}
+	_wake.notify_all();
+
+	return generation;
+}
+
+void tile_scheduler::cancel() {
+	++_generation;
+
+	int dropped = 0;
+	for (auto& q : _queues) {
+		std::lock_guard<std::mutex> guard(q->lock);
+		dropped += (int)q->tiles.size();
+		_queued -= (int)q->tiles.size();
+		q->tiles.clear();
+	}
+	finish_tiles(dropped);
+
+	wait();
+}
+
+void tile_scheduler::wait() {
+	std::unique_lock<std::mutex> guard(_lock);
+	_idle.wait(guard, [this]() { return _outstanding == 0; });
+}
+
+bool tile_scheduler::is_busy() const {
+	return _outstanding > 0;
+}
+
+bool tile_scheduler::is_cancelled(unsigned generation) const {
+	return generation != _generation;
+}
+
+bool tile_scheduler::is_cancelled(const tile& t) const {
+	return is_cancelled(t.generation);
+}
+
+int tile_scheduler::getThreadCount() const {
+	return (int)_threads.size();
+}
+
+tile_scheduler& tile_scheduler::shared() {
+	static tile_scheduler scheduler;
+	return scheduler;
+}
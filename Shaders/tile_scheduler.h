@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Persistent worker pool that renders an image in tiles.
+* Each worker owns a deque of tiles and steals from the others once its own
+* runs dry, so views where a few tiles cost orders of magnitude more than the
+* rest still keep every core busy. Tiles closest to a focus point (cursor or
+* screen center) are handed out first, and a job can be cancelled at any time.
+*/
+class tile_scheduler {
+
+public:
+
+	struct tile {
+		int x0, y0, x1, y1;
+		unsigned generation;
+	};
+
+	using job = std::function<void(const tile&)>;
+
+private:
+
+	struct worker_queue {
+		std::mutex lock;
+		std::deque<tile> tiles;
+	};
+
+	std::vector<std::thread> _threads;
+	std::vector<std::unique_ptr<worker_queue>> _queues;
+
+	job _job;
+
+	std::atomic<unsigned> _generation;
+	std::atomic<int> _queued;
+	std::atomic<int> _outstanding;
+	bool _quit = false;
+
+	std::mutex _lock;
+	std::condition_variable _wake;
+	std::condition_variable _idle;
+
+	bool pop(int worker, tile& t);
+
+	void finish_tiles(int count);
+
+	void worker_main(int worker);
+
+public:
+
+	//threads == 0 uses every hardware thread
+	explicit tile_scheduler(int threads = 0);
+
+	tile_scheduler(const tile_scheduler&) = delete;
+	tile_scheduler& operator=(const tile_scheduler&) = delete;
+
+	~tile_scheduler();
+
+	//Split width x height into square tiles and run fn on each, closest to focus first.
+	//A job still running is cancelled first, so fn may capture state the previous job used.
+	//Returns the generation of the new job.
+	unsigned submit(int width, int height, int tileSize, glm::vec2 focus, job fn);
+
+	//Drop queued tiles and wait for tiles already running, which should return early
+	//once is_cancelled reports true for their generation
+	void cancel();
+
+	//Block until every tile of the current job finished or was cancelled
+	void wait();
+
+	bool is_busy() const;
+
+	//True once a newer job was submitted or cancel was called
+	bool is_cancelled(unsigned generation) const;
+
+	bool is_cancelled(const tile& t) const;
+
+	int getThreadCount() const;
+
+	//Pool shared by the CPU renderers
+	static tile_scheduler& shared();
+
+};
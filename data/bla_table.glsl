@@ -0,0 +1,36 @@
+//Bilinear approximation table for skipping iterations, written by bla_table::upload.
+//Layout must match Shaders/bla_table.h (std430).
+
+struct BlaEntry {
+	dvec2 a;
+	dvec2 b;
+	double radius;	//Valid while |dz| < radius
+};
+
+layout(std430, binding = 2) readonly buffer BilinearApprox {
+	int blaSteps;			//Single steps in level 0, from orbit index 1
+	int blaLevels;
+	int blaLevelStart[32];
+	BlaEntry bla[];
+};
+
+//Same search as bla_table::find, the largest valid entry at orbit index m
+bool blaFind(int m, double dzMag2, int maxSteps, out BlaEntry e, out int steps) {
+	int j = m - 1;
+	if (j < 0 || blaSteps == 0)
+		return false;
+
+	int top = j == 0 ? blaLevels - 1 : min(findLSB(j), blaLevels - 1);
+	for (int l = top; l >= 0; l--) {
+		int index = j >> l;
+		if (index >= (blaSteps >> l) || (1 << l) > maxSteps)
+			continue;
+
+		e = bla[blaLevelStart[l] + index];
+		if (dzMag2 < e.radius * e.radius) {
+			steps = 1 << l;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,9 @@
+#version 460
+
+layout(binding = 0) uniform sampler2D image_tex;
+
+out vec4 FragColor;
+
+void main() {
+	FragColor = vec4(texelFetch(image_tex, ivec2(gl_FragCoord.xy), 0).rgb, 1.0);
+}
@@ -0,0 +1,18 @@
+//Escape iterations of sampled pixels, cleared and read back by iteration_budget.
+//Layout must match Shaders/iteration_budget.h (std430). Needs frame_globals.glsl.
+
+#define ESCAPE_BINS 64
+
+layout(std430, binding = 3) buffer EscapeHistogram {
+	uint escapeBins[ESCAPE_BINS + 1];	//Over [0, maxIterations), the last counts samples that never escaped
+};
+
+//Only one pixel in each 4x4 block records, which keeps the atomics cheap
+//and still leaves plenty of samples for the percentiles the tuning needs
+void recordEscape(int iterations) {
+	if (any(notEqual(ivec2(gl_FragCoord.xy) & 3, ivec2(0))))
+		return;
+
+	int bin = iterations < 0 ? ESCAPE_BINS : min(iterations * ESCAPE_BINS / maxIterations, ESCAPE_BINS - 1);
+	atomicAdd(escapeBins[bin], 1u);
+}
@@ -0,0 +1,22 @@
+//Per-frame values shared by every program through a single uniform buffer.
+//Layout must match struct frame_globals in Shaders/frame_globals.h (std140).
+
+struct Camera {
+	vec3 loc;
+	vec3 lookAt;
+	vec3 up;
+	vec3 right;
+	float fov; //1.0 == 90 degrees
+};
+
+layout(std140, binding = 0) uniform FrameGlobals {
+	Camera camera;
+	vec2 resolution;
+	vec2 cursorPos;
+	float time;
+	float elapsedTime;
+	float zoom;
+	float zoomRaw;
+	int maxIterations;	//Iteration cap of escape time scenes, 0 for the others
+	int samples;		//Samples per pixel of supersampling scenes, 0 for the others
+};
@@ -1,19 +1,7 @@
 #version 460
 
-#define PART_SKY	0
-#define PART_SET	1
-#define PART_INC	2
-
 #define SQRT_2 		0.7071067812
 
-struct Camera {
-	vec3 loc;
-	vec3 lookAt;
-	vec3 up;
-	vec3 right;
-	float fov;
-};
-
 struct DirLight {
 	vec3 dir;
 	vec3 amb;
@@ -21,19 +9,11 @@ struct DirLight {
 	vec3 spec;
 };
 
-uniform vec2 resolution;
-uniform float time;
-uniform float elapsedTime;
-uniform float zoom;
-uniform float zoomRaw;
-
-uniform Camera camera;
-
-layout(binding = 0) uniform isampler2D part_tex;
-layout(binding = 1) uniform sampler2D normal_tex;
-layout(binding = 2) uniform isampler2D mask_tex;
+#include "frame_globals.glsl"
+#include "mandelbowl_gbuffer.glsl"
+#include "tile_cache.glsl"
 
-out vec4 FragColor;
+layout(binding = 0) uniform sampler2D gbuffer_tex;
 
 const vec3 sky = vec3(.53, .81, .92);
 const vec3 black = vec3(0.0);
@@ -53,24 +33,26 @@ vec3 getLightColor(in vec3 norm, in vec3 col) {
 	return ambient + diffuse + specular;
 }
 
-void main() {	
-	vec3 up = vec3(0.0, 0.0, 1.0);
-	vec3 cd = normalize(camera.lookAt - camera.loc);
-	vec3 cx = normalize(camera.right);
-	vec3 cy = normalize(camera.up);
-	mat4 view = mat4(cx, 0.0, cy, 0.0, cd, 0.0, 0.0, 0.0, 0.0, 1.0);
-	
-	vec2 p = gl_FragCoord.xy;
+void main() {
+	//Progressive levels draw into a corner of the targets, only the level's pixels are read
+	loadTile(gbuffer_tex, ivec2(resolution));
+
+	ivec2 p = tilePixel();
+	if (!tileWrites(p))
+		return;
+
 	int partID[9];
 	int mask[9];
-	partID[8] = texture(part_tex, p / resolution).x;
-	mask[8] = texture(mask_tex, p / resolution).x;
+	vec4 geometry = tileTexel(ivec2(0));
+	partID[8] = decodePart(geometry);
+	mask[8] = decodeMask(geometry);
 	
 	vec2 offset = vec2(-1.0);
 	vec2 dOffset = vec2(1.0, 0.0);
 	for (int i = 0; i < 8; i++, offset += dOffset) {
-		partID[i] = texture(part_tex, (p + offset) / resolution).x;
-		mask[i] = texture(mask_tex, (p + offset) / resolution).x;
+		geometry = tileTexel(ivec2(offset));
+		partID[i] = decodePart(geometry);
+		mask[i] = decodeMask(geometry);
 		if (i % 2 == 0 && i > 0)
 			dOffset = dOffset.yx;
 		if (i % 4 == 0 && i > 0)
@@ -87,16 +69,18 @@ void main() {
 		}
 	}
 	
+	//Half pixel offsets from the pixel center, each reads the texel nearest filtering picked for it
 	offset = vec2(-0.5);
 	dOffset = vec2(0.5, 0.0);
 	vec3 col = partCol[8];
 	for (int i = 0; i < 8; i++, offset += dOffset) {
-		col = (col * (i + 1) + getLightColor(texture(normal_tex, (p + offset) / resolution).xyz, mix(partCol[8], partCol[i], 0.5))) / (i + 2);
+		vec3 normal = decodeNormal(tileTexel(ivec2(floor(0.5 + offset))));
+		col = (col * (i + 1) + getLightColor(normal, mix(partCol[8], partCol[i], 0.5))) / (i + 2);
 		if (i % 2 == 0 && i > 0)
 			dOffset = dOffset.yx;
 		if (i % 4 == 0 && i > 0)
 			dOffset = -dOffset;
 	}
 	
-	FragColor = vec4(col, 1.0);
-}
\ No newline at end of file
+	imageStore(scene_image, p, vec4(col, 1.0));
+}
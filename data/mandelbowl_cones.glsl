@@ -0,0 +1,70 @@
+#version 460
+layout (location = 0) out vec2 bCone;
+
+//Marches one cone per CONE_TILE x CONE_TILE pixels of the normal pass, wide enough to hold the rays of all of them.
+//Space the cone is clear of is clear for every ray in it, so each pixel can skip to where the cone stopped instead
+//of finding its own way through the empty part of the bowl. Writes the depth the march started at and where it ended.
+
+//Full resolution pixels per side of a texel, must match mandelbowl::CONE_TILE
+#define CONE_TILE	8
+
+#include "frame_globals.glsl"
+#include "mandelbrot_interior.glsl"
+#include "mandelbowl_distance.glsl"
+#include "mandelbowl_march.glsl"
+
+vec3 viewRay(in mat4 view, in vec2 frag) {
+	vec2 p = (2.0 * frag - resolution) / (resolution.y * zoom);
+	return normalize((view * vec4(p, camera.fov, 0.0)).xyz);
+}
+
+void main() {
+	vec3 cd = normalize(camera.lookAt - camera.loc);
+	vec3 cx = normalize(camera.right);
+	vec3 cy = normalize(camera.up);
+	mat4 view = mat4(cx, 0.0, cy, 0.0, cd, 0.0, 0.0, 0.0, 0.0, 1.0);
+
+	//Pixels of the tile lie within its corners, the widest of their angles to the center bounds the cone
+	vec2 lo = floor(gl_FragCoord.xy) * CONE_TILE;
+	vec2 hi = lo + CONE_TILE;
+	vec3 ro = camera.loc;
+	vec3 rays[5] = vec3[5](viewRay(view, 0.5 * (lo + hi)), viewRay(view, lo), viewRay(view, hi),
+		viewRay(view, vec2(lo.x, hi.y)), viewRay(view, vec2(hi.x, lo.y)));
+	vec3 rd = rays[0];
+
+	//The cone starts where the first of these rays would and runs until the last leaves the bowl
+	float cosCone = 1.0;
+	float start = 1e20;
+	float end = -1.0;
+	for (int i = 0; i < 5; i++) {
+		cosCone = min(cosCone, dot(rd, rays[i]));
+
+		vec2 intersections = eliIntersect(ro, rays[i], ELLIPSOID);
+		float s = ro.z >= 0.0 ? -ro.z / rays[i].z : intersections.x;
+		if (s >= 0.0 && intersections.y >= 0.0) {
+			start = min(start, s);
+			end = max(end, intersections.y);
+		}
+	}
+	float tanCone = 1.01 * sqrt(max(1.0 - cosCone * cosCone, 0.0)) / cosCone;
+
+	//No ray the bowl could be seen along, nothing to skip
+	if (end < 0.0) {
+		bCone = vec2(0.0);
+		return;
+	}
+
+	//A ray of the cone at depth s is within (s - t) + s·tanCone of the center at t. Steps keep that inside
+	//the empty sphere around the center, so the cone stays clear up to where it is as wide as the sphere.
+	float t = start;
+	for (int i = 0; i < 128 && t <= end; i++) {
+		float h = map(ro + t * rd);
+		float r = t * tanCone;
+		if (h <= r)
+			break;
+
+		t += (h - r) / (1.0 + tanCone);
+	}
+
+	bCone = vec2(start, t);
+}
@@ -0,0 +1,59 @@
+//Distance estimate of the Mandelbrot set shared by the Mandelbowl passes, and the
+//precomputed field of it the normal pass marches through.
+//Needs mandelbrot_interior.glsl. DE_ITERATIONS defaults to FrameGlobals.maxIterations.
+
+#ifndef DE_ITERATIONS
+#define DE_ITERATIONS maxIterations
+#endif
+
+//The field covers x in [-2, 2] and r = length(yz) in [0, 1.25], the bounding ellipsoid of the bowl.
+//Size must match mandelbowl::FIELD_WIDTH and FIELD_HEIGHT.
+#define FIELD_MIN		vec2(-2.0, 0.0)
+#define FIELD_EXTENT	vec2(4.0, 1.25)
+#define FIELD_SIZE		vec2(2048.0, 640.0)
+
+//change to be my own
+//https://iquilezles.org/articles/distancefractals
+float distanceToMandelbrot(in vec2 c) {
+	// skip computation inside M1 and M2
+	if (inMainBulbs(c)) return 0.0;
+
+    // iterate
+    float di =  1.0;
+    vec2 z  = vec2(0.0);
+    float m2 = 0.0;
+    vec2 dz = vec2(0.0);
+    PeriodCheck period = periodStart();
+    for( int i=0; i<DE_ITERATIONS; i++ )
+    {
+        if( m2>1024.0 ) { 
+			di=0.0; 
+			break; 
+		}
+
+		// Z' -> 2·Z·Z' + 1
+        dz = 2.0*vec2(z.x*dz.x-z.y*dz.y, z.x*dz.y + z.y*dz.x) + vec2(1.0,0.0);
+			
+        // Z -> Z² + c			
+        z = vec2( z.x*z.x - z.y*z.y, 2.0*z.x*z.y ) + c;
+			
+        m2 = dot(z,z);
+
+        // caught in a cycle, inside the set
+        if (m2 <= 1024.0 && periodRepeats(period, z)) return 0.0;
+    }
+
+    // distance	
+	// d(c) = |Z|·log|Z|/|Z'|
+	float d = 0.5*sqrt(dot(z,z)/dot(dz,dz))*log(sqrt(dot(z,z)));
+    if( di>0.5 ) 
+		d=0.0;
+	
+    return d;
+}
+
+//(x, r) of the center of a field texel
+vec2 fieldPosition(in vec2 texel) {
+	return FIELD_MIN + texel / FIELD_SIZE * FIELD_EXTENT;
+}
+
@@ -0,0 +1,16 @@
+#version 460
+layout (location = 0) out float bDistance;
+
+//Builds the distance field of the Mandelbowl surface once. The bowl is a solid of
+//revolution, so its distance is a function of x and r = length(yz) only.
+//Iterates at the base cap (mandelbowl::BASE_ITERATIONS), points that need more are near the surface where the
+//normal pass uses the exact estimate anyway.
+
+#define DE_ITERATIONS 300
+
+#include "mandelbrot_interior.glsl"
+#include "mandelbowl_distance.glsl"
+
+void main() {
+	bDistance = distanceToMandelbrot(fieldPosition(gl_FragCoord.xy));
+}
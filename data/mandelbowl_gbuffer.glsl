@@ -0,0 +1,33 @@
+//G-buffer of the Mandelbowl, one GL_RGB10_A2 texel per pixel written by the normal pass.
+//rg is the normal in octahedral coordinates, b the mask (1 where a ray hit the bowl), a the part / 3.
+
+#define PART_SKY	0
+#define PART_SET	1
+#define PART_INC	2
+
+//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec2 octWrap(in vec2 v) {
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec4 encodeGBuffer(in vec3 normal, in int part, in int mask) {
+	vec3 n = normal / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+	vec2 oct = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+	return vec4(0.5 * oct + 0.5, float(mask), float(part) / 3.0);
+}
+
+vec3 decodeNormal(in vec4 texel) {
+	vec2 f = 2.0 * texel.xy - 1.0;
+	vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+int decodePart(in vec4 texel) {
+	return int(round(texel.a * 3.0));
+}
+
+int decodeMask(in vec4 texel) {
+	return int(round(texel.b));
+}
@@ -0,0 +1,42 @@
+//Ray marching through the distance field, shared by the cone and normal passes of the Mandelbowl.
+//Needs mandelbowl_distance.glsl.
+
+//Field distances are trusted down to this many texel diagonals, closer the exact estimate is taken
+#define FIELD_EXACT_TEXELS	4.0
+
+#define ELLIPSOID	vec3(2.0, 1.25, 1.25)
+
+layout(binding = 3) uniform sampler2D field_tex;
+
+//ellipsoid centered at the origin with radii ra
+//taken from https://iquilezles.org/articles/intersectors/
+vec2 eliIntersect( in vec3 ro, in vec3 rd, in vec3 ra )
+{
+    vec3 ocn = ro/ra;
+    vec3 rdn = rd/ra;
+    float a = dot( rdn, rdn );
+    float b = dot( ocn, rdn );
+    float c = dot( ocn, ocn );
+    float h = b*b - a*(c-1.0);
+    if( h<0.0 ) return vec2(-1.0); //no intersection
+    h = sqrt(h);
+    return vec2(-b-h,-b+h)/a;
+}
+
+float map(in vec3 pos) {
+	//calculate arc up to xy-plane
+	vec2 q = vec2(pos.x, length(pos.yz));
+
+	//The set lies inside the field, past its edge the distance to the edge adds in quadrature to the distance there
+	vec2 edge = clamp(q, FIELD_MIN, FIELD_MIN + FIELD_EXTENT);
+	vec2 outside = q - edge;
+
+	//The field is filtered between texels, a texel diagonal off it is a safe step anywhere in the texel.
+	//Near the surface the field is too coarse, the exact estimate refines the hit.
+	float diagonal = length(FIELD_EXTENT / FIELD_SIZE);
+	float d = texture(field_tex, (edge - FIELD_MIN) / FIELD_EXTENT).x - diagonal;
+	if (d > FIELD_EXACT_TEXELS * diagonal)
+		return sqrt(dot(outside, outside) + d * d);
+
+	return distanceToMandelbrot(q);
+}
@@ -1,33 +1,21 @@
 #version 460
-layout (location = 0) out vec3 bNormal;
-layout (location = 1) out int bMask;
-
-#define PART_SKY	0
-#define PART_SET	1
-#define PART_INC	2
+layout (location = 0) out vec4 bGeometry;
 
 #define FLOAT_PREC 	0.0000005
 #define PI			3.141592654
 #define PI_2 		1.570796327
 #define SQRT_2 		0.7071067812
 
-struct Camera {
-	vec3 loc;
-	vec3 lookAt;
-	vec3 up;
-	vec3 right;
-	float fov;
-};
-
-uniform vec2 resolution;
-uniform float time;
-uniform float elapsedTime;
-uniform float zoom;
-uniform float zoomRaw;
+//Full resolution pixels per side of a texel of the cone pass, must match mandelbowl::CONE_TILE
+#define CONE_TILE	8
 
-uniform Camera camera;
+#include "frame_globals.glsl"
+#include "mandelbrot_interior.glsl"
+#include "mandelbowl_distance.glsl"
+#include "mandelbowl_march.glsl"
+#include "mandelbowl_gbuffer.glsl"
 
-layout(binding = 0) uniform isampler2D part_tex;
+layout(binding = 4) uniform sampler2D cone_tex;
 
 //precision equalf
 bool equalf(in float a, in float b) {
@@ -35,221 +23,66 @@ bool equalf(in float a, in float b) {
 	return diff < FLOAT_PREC || diff < abs(a * FLOAT_PREC) || diff < abs(b * FLOAT_PREC);
 }
 
-//ellipsoid centered at the origin with radii ra
-//taken from https://iquilezles.org/articles/intersectors/
-vec2 eliIntersect( in vec3 ro, in vec3 rd, in vec3 ra )
-{
-    vec3 ocn = ro/ra;
-    vec3 rdn = rd/ra;
-    float a = dot( rdn, rdn );
-    float b = dot( ocn, rdn );
-    float c = dot( ocn, ocn );
-    float h = b*b - a*(c-1.0);
-    if( h<0.0 ) return vec2(-1.0); //no intersection
-    h = sqrt(h);
-    return vec2(-b-h,-b+h)/a;
+vec2 cmul(in vec2 a, in vec2 b) {
+	return vec2(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x);
 }
 
-//change to be my own
-//https://iquilezles.org/articles/distancefractals
-float distanceToMandelbrot(in vec2 c) {
-	float c2 = dot(c, c);
-	// skip computation inside M1 - https://iquilezles.org/articles/mset1bulb
-	if( 256.0*c2*c2 - 96.0*c2 + 32.0*c.x - 3.0 < 0.0 ) return 0.0;
-	// skip computation inside M2 - https://iquilezles.org/articles/mset2bulb
-	if( 16.0*(c2+2.0*c.x+1.0) - 1.0 < 0.0 ) return 0.0;
+vec2 cdiv(in vec2 a, in vec2 b) {
+	return cmul(a, vec2(b.x, -b.y)) / dot(b, b);
+}
 
-    // iterate
-    float di =  1.0;
-    vec2 z  = vec2(0.0);
-    float m2 = 0.0;
-    vec2 dz = vec2(0.0);
-    for( int i=0; i<300; i++ )
-    {
-        if( m2>1024.0 ) { 
-			di=0.0; 
-			break; 
-		}
+//Distance estimate with its gradient in c, 0 inside the set.
+//Z'' is carried with Z and Z' in the same iteration, d = |Z|·log|Z| / (2|Z'|) then has
+//grad log d = conj(Z'/Z · (1 + 1/log|Z|) - Z''/Z')
+vec3 distanceGradient(in vec2 c) {
+	if (inMainBulbs(c)) return vec3(0.0);
+
+	vec2 z = vec2(0.0);
+	vec2 dz = vec2(0.0);
+	vec2 ddz = vec2(0.0);
+	float m2 = 0.0;
+	PeriodCheck period = periodStart();
+	for (int i = 0; i < DE_ITERATIONS && m2 <= 1024.0; i++) {
+		// Z'' -> 2·(Z'² + Z·Z'')
+		ddz = 2.0 * (cmul(dz, dz) + cmul(z, ddz));
 
 		// Z' -> 2·Z·Z' + 1
-        dz = 2.0*vec2(z.x*dz.x-z.y*dz.y, z.x*dz.y + z.y*dz.x) + vec2(1.0,0.0);
-			
-        // Z -> Z² + c			
-        z = vec2( z.x*z.x - z.y*z.y, 2.0*z.x*z.y ) + c;
-			
-        m2 = dot(z,z);
-    }
+		dz = 2.0 * cmul(z, dz) + vec2(1.0, 0.0);
 
-    // distance	
-	// d(c) = |Z|·log|Z|/|Z'|
-	float d = 0.5*sqrt(dot(z,z)/dot(dz,dz))*log(sqrt(dot(z,z)));
-    if( di>0.5 ) 
-		d=0.0;
-	
-    return d;
-}
+		// Z -> Z² + c
+		z = cmul(z, z) + c;
 
-vec2 distanceToMandelbrot2(in vec4 c) {
-	float c12 = dot(c.xy, c.xy);
-	float c22 = dot(c.zw, c.zw);
-	
-	vec2 d = vec2(1.0);
-	
-	// skip computation inside M1 - https://iquilezles.org/articles/mset1bulb
-	if (256.0*c12*c12 - 96.0*c12 + 32.0*c.x - 3.0 < 0.0) 
-		d.x = 0.0;
-	
-	// skip computation inside M2 - https://iquilezles.org/articles/mset2bulb
-	if (16.0*(c12+2.0*c.x+1.0) - 1.0 < 0.0) 
-		d.x = 0.0;
-	
-	// skip computation inside M1 - https://iquilezles.org/articles/mset1bulb
-	if (256.0*c22*c22 - 96.0*c22 + 32.0*c.z - 3.0 < 0.0) 
-		d.y = 0.0;
-	
-	// skip computation inside M2 - https://iquilezles.org/articles/mset2bulb
-	if (16.0*(c22+2.0*c.z+1.0) - 1.0 < 0.0) 
-		d.y = 0.0;
-		
-	if (d.x == 0.0 && d.y == 0.0)
-		return d;
+		m2 = dot(z, z);
 
-    // iterate
-    vec2 di = vec2(1.0);
-    vec4 z  = vec4(0.0);
-    vec2 m2 = vec2(0.0);
-    vec4 dz = vec4(0.0);
-    for (int i=0; i<300; i++) {
-        if (m2.x>1024.0) { 
-			di.x = 0.0;
-		}
-		
-		if (m2.y > 1024.0) {
-			di.y = 0.0;
-		}
-		
-		if (di.x == 0.0 && di.y == 0.0) {
-			break;
-		}
+		if (m2 <= 1024.0 && periodRepeats(period, z)) return vec3(0.0);
+	}
 
-		// Z' -> 2·Z·Z' + 1
-        dz = 2.0*vec4(z.xz*dz.xz-z.yw*dz.yw, z.xz*dz.yw + z.yz*dz.xw) + vec4(1.0,0.0,1.0,0.0);			
-        // Z -> Z² + c			
-        z = vec4( z.xz*z.xz - z.yw*z.yw, 2.0*z.xz*z.yw ) + c;
-			
-        m2 = vec2(dot(z.xy,z.xy), dot(z.zw,z.zw));
-    }
+	if (m2 <= 1024.0)
+		return vec3(0.0);
 
-    // distance	
-	// d(c) = |Z|·log|Z|/|Z'|
-	vec2 dotZ = vec2(dot(z.xy,z.xy),dot(z.zw,z.zw));
-	vec2 dotDZ = vec2(dot(dz.xy,dz.xy),dot(dz.zw,dz.zw));
-	d = 0.5 * sqrt(dotZ / dotDZ) * log(sqrt(dotZ));
-    
-	if (di.x > 0.5) 
-		d.x = 0.0;
-		
-	if (di.y > 0.5)
-		d.y = 0.0;
-	
-    return d;
-}
-
-float map(in vec3 pos) {
-	//calculate arc up to xy-plane
-	return distanceToMandelbrot(vec2(pos.x, length(pos.yz)));
-}
+	float logZ = 0.5 * log(m2);
+	float d = 0.5 * sqrt(m2 / dot(dz, dz)) * logZ;
 
-//Find the maximum point on the epsilon circle away from the equipotential curve
-//Return angle of that maximum point
-float findMaxDiffInDist(in float eps, in float dist, in vec2 pos) {
-	float maxDist = dist;
-	float thetaLoc = -8.0;
-	
-	//Search for a point that's close to the maximum point
-	for (float theta = 0; theta > 2.0 * (PI - FLOAT_PREC); theta += PI / 36) {
-		float newDist = distanceToMandelbrot(pos + eps * vec2(cos(theta), sin(theta)));
-		float newDiff = abs(newDist - dist);
-		float curDiff = abs(maxDist - dist);
-		bool change = newDiff >= curDiff;
-		maxDist = change ? newDist : maxDist;
-		thetaLoc = change ? theta : thetaLoc;
-	}
-	
-	int dPow = 4;
-	float dTheta = PI / 72;
-	float lastDiff = abs(maxDist - dist);
-	
-	//Newton's Method
-	for (float theta = thetaLoc + dTheta; dPow < 17; theta += dTheta) {
-		float newDist = distanceToMandelbrot(pos + eps * vec2(cos(theta), sin(theta)));
-		float newDiff = abs(newDist - dist);
-		bool change = newDiff < lastDiff || newDiff == lastDiff;
-		dPow = change ? dPow + 1 : dPow;
-		dTheta = (change ? -1 : 1) * (PI / (9 * pow(2, dPow)));
-		lastDiff = newDiff;
-		thetaLoc = theta;
-	}
-	
-	return thetaLoc;
-}
+	//Z'' overflows first on orbits that escape late, the potential's gradient then gives the direction
+	vec2 g = cdiv(dz, z) * (1.0 + 1.0 / logZ);
+	vec2 g2 = cdiv(ddz, dz);
+	if (!any(isinf(g2)) && !any(isnan(g2)))
+		g -= g2;
 
-//Find the normal of a point on the border of the mandelbrot set
-//using the intersection points of a circle of radius epsilon
-//and the equipotential curve defined by the Douady-Hubbard potential
-//at a specific distance from the mandelbrot set
-vec2 findNormal(in float dist, in vec2 pos) {
-	float eps = 1.0 / 368.0;
-	
-	float maxTheta = findMaxDiffInDist(eps, dist, pos);
-	vec2 thetas = vec2(maxTheta, maxTheta - 2.0 * PI);
-	vec2 dTheta = vec2(-PI / 36, PI / 36);
-	
-	float maxDist = distanceToMandelbrot(pos + eps * vec2(cos(maxTheta), sin(maxTheta)));
-	vec2 last = vec2(maxDist);
-	const vec2 dist2 = vec2(dist);
-	
-	//36 = 9 * (2^2), 16 - 2 = 14
-	//theoretical max first time around is 36
-	//thus 36 + (1 / 0.5) * 14 = 64
-	for (int i = 0; i < 64; i++) {
-		thetas += dTheta;
-		vec2 cosT = cos(thetas);
-		vec2 sinT = sin(thetas);
-		
-		//Get distance for new positions around epsilon circle
-		//vec2 newDist = distanceToMandelbrot2(vec4(pos, pos) + eps * vec4(cosT.x, sinT.x, cosT.y, sinT.y));
-		float newDist1 = distanceToMandelbrot(pos + eps * vec2(cosT.x, sinT.x));
-		float newDist2 = distanceToMandelbrot(pos + eps * vec2(cosT.y, sinT.y));
-		vec2 newDist = vec2(newDist1, newDist2);
-		
-		//Compare distance to previous distances
-		vec2 newDiff = abs(newDist - dist2);
-		vec2 lastDiff = abs(last - dist2);
-		bvec2 change = greaterThan(newDiff, lastDiff);
-		
-		//If the new distances are greater than the previous distances,
-		//then we have passed the equipotential curve and we must change
-		//direction and divide our dTheta by two
-		vec2 dirTheta = vec2(change.x ? -0.5 : 1.0, change.y ? -0.5 : 1.0);
-		dTheta *= dirTheta;
-	}
-	
-	//thetas now has the angles of the equipotential curve on the epsilon circle
-	vec2 cosT = cos(thetas);
-	vec2 sinT = sin(thetas);
-	vec4 equiPos = vec4(pos + eps * vec2(cosT.x, sinT.x), pos + eps * vec2(cosT.y, sinT.y));
-	
-	vec2 dir = normalize(equiPos.xy - equiPos.zw);
-	vec2 norm = (maxDist < dist ? 1.0 : -1.0) * vec2(dir.y, -dir.x);
-	
-	return norm;
+	return vec3(d, d * vec2(g.x, -g.y));
 }
 
-//Cast a ray into the scene to see what it hits
-float raycast(in vec3 ro, in vec3 rd, in vec3 rdx, in vec3 rdy) {
-	vec2 intersections = eliIntersect(ro, rd, vec3(2.0, 1.25, 1.25));
+//Cast a ray into the scene to see what it hits.
+//cone is the depth range of the cone pass no ray of this tile hits anything in, rays starting inside it skip to its end.
+float raycast(in vec3 ro, in vec3 rd, in vec3 rdx, in vec3 rdy, in vec2 cone) {
+	vec2 intersections = eliIntersect(ro, rd, ELLIPSOID);
 	float t = ro.z >= 0.0 ? -ro.z / rd.z : intersections.x;
+
+	if (t >= cone.x && cone.y > t) {
+		t = cone.y;
+		if (t > intersections.y)
+			return -1.0;
+	}
 	
 	for (int i = 0; i < 128; i++) {
 		vec3 pos = ro + t * rd;
@@ -273,11 +106,40 @@ float raycast(in vec3 ro, in vec3 rd, in vec3 rdx, in vec3 rdy) {
 	return t;
 }
 
-void main() {
-	bNormal = vec3(0.0);
-	bMask = 0;
+//Whether the pixel sees the sky, the set in the xy-plane or the inside of the bowl
+int classify() {
+	//The classification ray has always gone through the transposed view matrix
+	vec3 cd = normalize(camera.lookAt - camera.loc);
+	vec3 cx = normalize(camera.right);
+	vec3 cy = normalize(camera.up);
+	mat4 view = transpose(mat4(cx, 0.0, cy, 0.0, cd, 0.0, 0.0, 0.0, 0.0, 1.0));
 
-	int partID = texture(part_tex, gl_FragCoord.xy / resolution).x;
+	vec2 pv = (2.0 * gl_FragCoord.xy - resolution) / (resolution.y * zoom);
+	vec3 ro = camera.loc;
+	vec3 rd = normalize((view * vec4(pv, camera.fov, 0.0)).xyz);
+
+	vec2 intersection = eliIntersect(ro, rd, ELLIPSOID);
+	float txy = !equalf(rd.z, 0.0) ? -ro.z / rd.z : -1.0;
+	//Twice the estimate, the test against 0 is the one the classification made with log|Z|^2
+	float dist = 2.0 * distanceToMandelbrot((ro + txy * rd).xy);
+
+	int part = PART_SKY;
+	bool set = equalf(dist, 0.0);
+	bool inc = intersection.x >= 0.0 || intersection.y >= 0.0;
+
+	//Remove top half of ellipsoid from consideration: one of the intersection points has to be
+	//below the xy-plane and in front of the camera
+	if (inc)
+		inc = ((ro + intersection.x * rd).z <= FLOAT_PREC && intersection.x >= 0.0) || ((ro + intersection.y * rd).z <= FLOAT_PREC && intersection.y >= 0.0);
+
+	part = inc ? PART_INC : part;
+	if (txy >= 0.0 && set)
+		part = PART_SET;
+	return part;
+}
+
+void main() {
+	int partID = classify();
 	
 	vec3 up = vec3(0.0, 0.0, 1.0);
 	vec3 cd = normalize(camera.lookAt - camera.loc);
@@ -295,24 +157,33 @@ void main() {
 	vec3 rdy = normalize((view * vec4(py, camera.fov, 0.0)).xyz);
 	
 	if (partID != PART_INC) {
-		bNormal = partID == PART_SKY ? -rd : vec3(0.0, 0.0, 1.0);
+		bGeometry = encodeGBuffer(partID == PART_SKY ? -rd : vec3(0.0, 0.0, 1.0), partID, 0);
 		return;
 	}
 	
-	float t = raycast(ro, rd, rdx, rdy);
+	vec2 cone = texelFetch(cone_tex, ivec2(gl_FragCoord.xy) / CONE_TILE, 0).xy;
+	float t = raycast(ro, rd, rdx, rdy, cone);
 	
 	if (t < 0.0) {
-		bNormal = -rd;
+		bGeometry = encodeGBuffer(-rd, partID, 0);
 		return;
 	}
-	bMask = 1;
 	
+	//The hit may land inside the set where the estimate has no gradient, back off along the ray by a pixel
 	vec3 pos = ro + t * rd;
 	vec2 posXY = vec2(pos.x, sign(pos.y) * length(pos.yz));
-	float dist = distanceToMandelbrot(posXY);
-	vec3 normal = vec3(findNormal(dist, posXY), 0.0);	
+	vec3 de = distanceGradient(posXY);
+	float pixel = t * length(rdx - rd);
+	for (int i = 0; i < 4 && de.x == 0.0; i++) {
+		pos -= pixel * rd;
+		posXY = vec2(pos.x, sign(pos.y) * length(pos.yz));
+		de = distanceGradient(posXY);
+	}
+
+	//Gradient in the (x, r) plane, points away from the set
+	vec3 normal = vec3(de.x > 0.0 ? normalize(de.yz) : -rd.xy, 0.0);
 	float cosA = dot(vec2(sign(pos.y), 0.0), normalize(pos.yz));
 	float sinA = length(cross(vec3(sign(pos.y), 0.0, 0.0), vec3(normalize(pos.yz), 0.0)));
 	mat2 rot = mat2(cosA, sinA, -sinA, cosA);
-	bNormal = vec3(normal.x, rot * normal.yz);
+	bGeometry = encodeGBuffer(vec3(normal.x, rot * normal.yz), partID, 1);
 }
\ No newline at end of file
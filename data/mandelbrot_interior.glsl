@@ -0,0 +1,66 @@
+//Interior detection shared by the escape time kernels.
+//Mirrored on the CPU by Shaders/mandelbrot_interior.h.
+
+//Squared distance below which an orbit point repeats the saved one
+#define PERIOD_TOLERANCE		1e-12
+#define PERIOD_TOLERANCE_DEEP	1e-20
+
+//c inside the main cardioid or the period 2 bulb never escapes
+bool inMainBulbs(in vec2 c) {
+	float c2 = dot(c, c);
+	// inside M1 - https://iquilezles.org/articles/mset1bulb
+	if (256.0*c2*c2 - 96.0*c2 + 32.0*c.x - 3.0 < 0.0)
+		return true;
+	// inside M2 - https://iquilezles.org/articles/mset2bulb
+	return 16.0*(c2+2.0*c.x+1.0) - 1.0 < 0.0;
+}
+
+//Brent periodicity check: z is compared against an orbit point saved at
+//power of two intervals, an orbit that repeats is caught in a cycle and never escapes
+struct PeriodCheck {
+	vec2 saved;
+	int counter;
+	int interval;
+};
+
+PeriodCheck periodStart() {
+	return PeriodCheck(vec2(0.0), 0, 1);
+}
+
+bool periodRepeats(inout PeriodCheck p, in vec2 z) {
+	vec2 d = z - p.saved;
+	if (dot(d, d) < PERIOD_TOLERANCE)
+		return true;
+
+	if (++p.counter == p.interval) {
+		p.saved = z;
+		p.counter = 0;
+		p.interval *= 2;
+	}
+	return false;
+}
+
+//Double version for perturbed orbits, steps > 1 when iterations were skipped
+struct PeriodCheckD {
+	dvec2 saved;
+	int counter;
+	int interval;
+};
+
+PeriodCheckD periodStartD() {
+	return PeriodCheckD(dvec2(0.0), 0, 1);
+}
+
+bool periodRepeatsD(inout PeriodCheckD p, in dvec2 z, in int steps) {
+	dvec2 d = z - p.saved;
+	if (dot(d, d) < PERIOD_TOLERANCE_DEEP)
+		return true;
+
+	p.counter += steps;
+	if (p.counter >= p.interval) {
+		p.saved = z;
+		p.counter = 0;
+		p.interval *= 2;
+	}
+	return false;
+}
@@ -0,0 +1,116 @@
+//Escape time kernels of the Mandelbrot passes, float coordinates for shallow
+//views and perturbation from the reference orbit for deep ones.
+//Needs frame_globals.glsl.
+
+#include "reference_orbit.glsl"
+#include "bla_table.glsl"
+#include "mandelbrot_interior.glsl"
+
+#define BAILOUT (256.0 * 256.0)
+
+//Escape records hold the smooth iteration count, the final |z|^2, the distance
+//estimate |z| log|z| / |dz/dc| and 1, or are all 0 for samples that never escaped.
+//escapedAt is the iteration the sample escaped on, -1 if it never did.
+vec4 mandelbrot(vec2 c, out int escapedAt) {
+	escapedAt = -1;
+	if (inMainBulbs(c))
+		return vec4(0.0);
+
+	vec2 z = vec2(0.0);
+	vec2 der = vec2(0.0);
+	PeriodCheck period = periodStart();
+	float i;
+	for (i = 0; i < float(maxIterations);) {
+		der = 2.0 * vec2(z.x * der.x - z.y * der.y, z.x * der.y + z.y * der.x) + vec2(1.0, 0.0);
+		z = vec2(z.x * z.x - z.y * z.y, z.x * z.y * 2.0) + c;
+		float mag2 = dot(z, z);
+		if (mag2 > BAILOUT)
+			break;
+		i += 1.0;
+
+		if (periodRepeats(period, z))
+			return vec4(0.0);
+	}
+	
+	if (i > float(maxIterations) - 1.0)
+		return vec4(0.0);
+		
+	escapedAt = int(i);
+	float mag2 = dot(z, z);
+	float de = 0.5 * sqrt(mag2 / dot(der, der)) * log(mag2);
+	return vec4(i - log2(log2(mag2)), mag2, de, 1.0);
+}
+
+//Iterates the offset dz of the pixel c = C + dc from the reference orbit Z:
+//dz' = 2 Z dz + dz^2 + dc. When the pixel gets closer to 0 than its offset
+//(where the offset loses precision and glitches) or the reference runs out,
+//the orbit is restarted from Z_0 with dz = Z + dz (rebasing).
+//While dz is small next to Z whole blocks of steps are taken at once from the BLA table.
+//Only the periodicity check applies here, c = C + dc rounded to double is too coarse
+//for the bulb tests near their boundaries
+dvec2 cmul(dvec2 a, dvec2 b) {
+	return dvec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+//Same record as mandelbrot(), the distance estimate already in pixels (2 pixelScale each)
+vec4 mandelbrotPerturbed(dvec2 dc, out int escapedAt) {
+	escapedAt = -1;
+
+	dvec2 dz = dvec2(0.0);
+	dvec2 z = dvec2(0.0);
+	//dz/dc, a BLA block maps it like dz: der' = A der + B
+	dvec2 der = dvec2(0.0);
+	int m = 0;
+	int i = 0;
+	PeriodCheckD period = periodStartD();
+	while (i < maxIterations) {
+		BlaEntry e;
+		int steps = 1;
+		if (blaFind(m, dot(dz, dz), maxIterations - i, e, steps)) {
+			der = cmul(e.a, der) + e.b;
+			dz = cmul(e.a, dz) + cmul(e.b, dc);
+		} else {
+			der = 2.0 * cmul(orbit[m] + dz, der) + dvec2(1.0, 0.0);
+			dz = cmul(2.0 * orbit[m] + dz, dz) + dc;
+		}
+		m += steps;
+
+		z = orbit[m] + dz;
+		double mag2 = dot(z, z);
+		if (mag2 > BAILOUT) {
+			i += steps - 1;
+			break;
+		}
+		i += steps;
+
+		if (periodRepeatsD(period, z, steps))
+			return vec4(0.0);
+
+		if (mag2 < dot(dz, dz) || m == orbitLength - 1) {
+			dz = z;
+			m = 0;
+		}
+	}
+
+	if (i >= maxIterations)
+		return vec4(0.0);
+
+	escapedAt = i;
+	float mag2 = float(dot(z, z));
+	double de = 0.5 * sqrt(double(mag2) / dot(der, der)) * double(log(mag2)) / (2.0 * pixelScale);
+	return vec4(float(i) - log2(log2(mag2)), mag2, float(de), 1.0);
+}
+
+//Escape record of one sample at frag in window coordinates (gl_FragCoord.xy is
+//the pixel center), with the distance estimate in pixels
+vec4 mandelbrotSample(vec2 frag, out int escapedAt) {
+	if (orbitLength > 0) {
+		dvec2 dc = (2.0 * dvec2(frag) - dvec2(resolution)) * pixelScale;
+		return mandelbrotPerturbed(dc, escapedAt);
+	}
+
+	vec2 c = (2.0 * frag - resolution) / (resolution.y * zoom) + camera.loc.xy;
+	vec4 e = mandelbrot(c, escapedAt);
+	e.z *= 0.5 * resolution.y * zoom;
+	return e;
+}
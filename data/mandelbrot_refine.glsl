@@ -0,0 +1,64 @@
+#version 460
+layout (location = 0) out vec4 bEscape;
+
+//Second Mandelbrot pass: adds up to FrameGlobals.samples per pixel where the image
+//has detail, flat regions keep their single sample. Writes the mean record of the
+//escaped samples with the fraction of samples that escaped in w.
+
+#include "frame_globals.glsl"
+#include "mandelbrot_kernels.glsl"
+#include "mandelbrot_reuse.glsl"
+
+//Smooth iterations across a 3x3 block above which its center is refined
+#define SPREAD_LIMIT 1.0
+//Pixels closer to the boundary than this are refined
+#define DE_LIMIT 1.0
+
+layout(binding = 0) uniform sampler2D samples_tex;
+
+//The boundary runs through the pixel, or the neighbors disagree in color or in set membership
+bool needsRefinement(ivec2 p, vec4 center) {
+	bool inside = center.w == 0.0;
+	if (!inside && center.z < DE_LIMIT)
+		return true;
+
+	ivec2 last = ivec2(resolution) - 1;
+	float lo = center.x;
+	float hi = center.x;
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			vec4 n = texelFetch(samples_tex, clamp(p + ivec2(dx, dy), ivec2(0), last), 0);
+			if ((n.w == 0.0) != inside)
+				return true;
+			lo = min(lo, n.x);
+			hi = max(hi, n.x);
+		}
+	}
+	return hi - lo > SPREAD_LIMIT;
+}
+
+void main() {
+	ivec2 p = ivec2(gl_FragCoord.xy);
+
+	//Kept pixels next to the exposed strips have new neighbors and are refined again
+	if (isKept(p, 1))
+		discard;
+
+	vec4 center = texelFetch(samples_tex, p, 0);
+
+	if (samples <= 1 || !needsRefinement(p, center)) {
+		bEscape = center;
+		return;
+	}
+
+	//R2 sequence offsets, k = 0 is the pixel center the first pass already sampled.
+	//Records inside the set are all 0, so the sum only counts the escaped samples.
+	vec4 sum = center;
+	for (int k = 1; k < samples; k++) {
+		vec2 offset = fract(0.5 + float(k) * vec2(0.7548776662, 0.5698402910)) - 0.5;
+		int escapedAt;
+		sum += mandelbrotSample(gl_FragCoord.xy + offset, escapedAt);
+	}
+
+	bEscape = sum.w > 0.0 ? vec4(sum.xyz / sum.w, sum.w / float(samples)) : vec4(0.0);
+}
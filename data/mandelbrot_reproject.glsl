@@ -0,0 +1,23 @@
+#version 460
+layout (location = 0) out vec4 bEscape;
+
+//Zoom preview of the Mandelbrot scene: stretches the previous frame's escape
+//records to the new scale without iterating. The true image is iterated on
+//the first frame the zoom holds still.
+
+#include "frame_globals.glsl"
+#include "mandelbrot_reuse.glsl"
+
+layout(binding = 0) uniform sampler2D previous_tex;
+
+void main() {
+	vec2 half_res = 0.5 * resolution;
+	vec2 q = (gl_FragCoord.xy - half_res) * reprojection.x + half_res + reprojection.zw;
+
+	//Zooming out exposes pixels the old view never had, the edge is stretched over them
+	vec4 e = texelFetch(previous_tex, clamp(ivec2(floor(q)), ivec2(0), ivec2(resolution) - 1), 0);
+
+	//Distance estimates are in pixels, which shrink by the zoom factor
+	e.z /= reprojection.x;
+	bEscape = e;
+}
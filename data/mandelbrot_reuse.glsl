@@ -0,0 +1,12 @@
+//Escape records the Mandelbrot passes take over from the previous frame, written by mandelbrot_inputs::upload.
+//Layout must match struct mandelbrot::reuse (std140).
+
+layout(std140, binding = 2) uniform MandelbrotReuse {
+	ivec4 keptPixels;	//x0, y0, x1, y1 of the pixels copied from the previous frame, empty when nothing was
+	vec4 reprojection;	//Old pixels per new pixel in x, offset of the old view in old pixels in zw
+};
+
+//margin shrinks the kept area, for passes whose result depends on neighbors
+bool isKept(ivec2 p, int margin) {
+	return all(greaterThanEqual(p, keptPixels.xy + margin)) && all(lessThan(p, keptPixels.zw - margin));
+}
@@ -0,0 +1,19 @@
+#version 460
+layout (location = 0) out vec4 bEscape;
+
+//First Mandelbrot pass: the escape record of one sample at every pixel center
+
+#include "frame_globals.glsl"
+#include "mandelbrot_kernels.glsl"
+#include "escape_histogram.glsl"
+#include "mandelbrot_reuse.glsl"
+
+void main() {
+	//Panned by whole pixels, the overlap was copied and only the exposed strips are iterated
+	if (isKept(ivec2(gl_FragCoord.xy), 0))
+		discard;
+
+	int escapedAt;
+	bEscape = mandelbrotSample(gl_FragCoord.xy, escapedAt);
+	recordEscape(escapedAt);
+}
@@ -0,0 +1,9 @@
+//Reference orbit for perturbation rendering, written by reference_orbit::upload.
+//Layout must match Shaders/reference_orbit.h (std430).
+
+layout(std430, binding = 1) readonly buffer ReferenceOrbit {
+	int orbitLength;	//0 when the view is shallow enough for float coordinates
+	int orbitPad;	//The iteration cap is FrameGlobals.maxIterations
+	double pixelScale;	//(2.0 * gl_FragCoord.xy - resolution) * pixelScale is the offset from the reference
+	dvec2 orbit[];		//Z_n of the reference point, orbit[0] == 0, the last entry is where it escaped or stopped
+};
@@ -0,0 +1,43 @@
+//Compute main passes of post processing scenes, dispatched by shader_object::dispatch_main.
+//Each work group loads its TILE_SIZE x TILE_SIZE pixels of one texture plus a TILE_APRON wide border
+//into shared memory once, the filter then reads every neighbor from there instead of the texture.
+
+//Must match shader_object::COMPUTE_TILE
+#define TILE_SIZE	16
+#define TILE_APRON	1
+#define TILE_SPAN	(TILE_SIZE + 2 * TILE_APRON)
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+//x0, y0, x1, y1 of the pixels this dispatch writes
+layout(location = 0) uniform ivec4 tileRect;
+
+layout(binding = 0, rgba8) uniform writeonly image2D scene_image;
+
+shared vec4 tileCache[TILE_SPAN * TILE_SPAN];
+
+ivec2 tilePixel() {
+	return tileRect.xy + ivec2(gl_GlobalInvocationID.xy);
+}
+
+//Every invocation of the group has to call this, including the ones past the rect.
+//Texels outside size are clamped to its edge.
+void loadTile(in sampler2D tex, in ivec2 size) {
+	ivec2 origin = tileRect.xy + ivec2(gl_WorkGroupID.xy) * TILE_SIZE - TILE_APRON;
+	for (uint i = gl_LocalInvocationIndex; i < TILE_SPAN * TILE_SPAN; i += TILE_SIZE * TILE_SIZE) {
+		ivec2 t = origin + ivec2(i % TILE_SPAN, i / TILE_SPAN);
+		tileCache[i] = texelFetch(tex, clamp(t, ivec2(0), size - 1), 0);
+	}
+
+	barrier();
+}
+
+//Texel of the loaded texture at offset from this invocation's pixel, at most TILE_APRON away
+vec4 tileTexel(in ivec2 offset) {
+	ivec2 t = ivec2(gl_LocalInvocationID.xy) + TILE_APRON + offset;
+	return tileCache[t.y * TILE_SPAN + t.x];
+}
+
+bool tileWrites(in ivec2 pixel) {
+	return all(lessThan(pixel, tileRect.zw));
+}
@@ -0,0 +1,50 @@
+#version 460
+
+//Upscales a scene drawn smaller than the window (dynamic resolution). Bilinear,
+//except that source pixels whose guide differs from the nearest one's are left
+//out, so edges the scene's own buffers know about stay sharp.
+
+//Layout must match struct screen::upscale_params (std140)
+layout(std140, binding = 3) uniform Upscale {
+	vec4 guideWeights;
+	ivec2 sourceSize;
+	ivec2 targetSize;
+	int hasGuide;
+};
+
+layout(binding = 0) uniform sampler2D source_tex;
+layout(binding = 1) uniform sampler2D guide_tex;
+
+out vec4 FragColor;
+
+void main() {
+	//Source position with texel centers on integers
+	vec2 q = gl_FragCoord.xy * vec2(sourceSize) / vec2(targetSize) - 0.5;
+	ivec2 base = ivec2(floor(q));
+	vec2 f = q - vec2(base);
+	ivec2 last = sourceSize - 1;
+
+	vec4 center = vec4(0.0);
+	if (hasGuide != 0)
+		center = texelFetch(guide_tex, clamp(ivec2(round(q)), ivec2(0), last), 0);
+
+	//The nearest texel always keeps a weight of at least 1/4
+	vec3 sum = vec3(0.0);
+	float weight = 0.0;
+	for (int i = 0; i < 4; i++) {
+		ivec2 o = ivec2(i & 1, i >> 1);
+		ivec2 t = clamp(base + o, ivec2(0), last);
+
+		vec2 b = mix(1.0 - f, f, vec2(o));
+		float w = b.x * b.y;
+		if (hasGuide != 0) {
+			vec4 d = texelFetch(guide_tex, t, 0) - center;
+			w *= exp(-dot(guideWeights, d * d));
+		}
+
+		sum += w * texelFetch(source_tex, t, 0).rgb;
+		weight += w;
+	}
+
+	FragColor = vec4(sum / weight, 1.0);
+}